@@ -0,0 +1,78 @@
+#ifndef _BENCHMARKS_H_
+#define _BENCHMARKS_H_
+
+#include <string>
+#include <vector>
+
+// Headless micro benchmarks on synthetic data, runnable from the GUI benchmark pane
+struct BenchmarkResult {
+    std::string name;
+    unsigned int threads;
+    unsigned int items;
+    double milliseconds;
+    // Relative to the baseline of the benchmark (single thread or reference implementation)
+    double speedup = 1.0;
+    // Deviation from the reference implementation, for benchmarks that check one:
+    // largest element error for matrices, number of differing results for tests
+    double maxError = 0.0;
+};
+
+namespace Benchmarks {
+    // Composes local matrices for itemCount random transforms with 1 to maxThreads threads
+    std::vector<BenchmarkResult> JobSystemScaling(unsigned int maxThreads, unsigned int itemCount);
+    // Full transform propagation on generated hierarchies of nodeCount nodes: a wide tree
+    // (16 children per node), a binary tree and long branches of 1000 levels from the root.
+    // Recursive scene graph walk, serial flat pass and parallel flat pass with 2 to maxThreads
+    // threads, whose matrices differing from the serial pass are counted as errors
+    std::vector<BenchmarkResult> TransformUpdate(unsigned int maxThreads, unsigned int nodeCount);
+    // Local matrix composition from SoA arrays: Transform::ComposeLocalMatrix per element
+    // against the scalar, SSE and (when compiled in) AVX kernels
+    std::vector<BenchmarkResult> LocalMatrixKernels(unsigned int itemCount);
+    // Frustum test of itemCount random world space spheres: BoundingSphere::IsOnFrustum per
+    // sphere against the scalar, SSE and (when compiled in) AVX batch kernels
+    std::vector<BenchmarkResult> FrustumCullingKernels(unsigned int itemCount);
+    // RenderQueue::Cull over itemCount random candidates, serial and with 2 to maxThreads threads
+    std::vector<BenchmarkResult> ParallelCulling(unsigned int maxThreads, unsigned int itemCount);
+    // Software occlusion culling of itemCount random boxes behind a wall and under a ground
+    // plane: occluder rasterization, pyramid build and box tests. The error column counts
+    // boxes culled although a ray cast reference sees part of them, which can only happen
+    // for slivers thinner than a pixel of the occlusion buffer.
+    std::vector<BenchmarkResult> OcclusionCulling(unsigned int itemCount);
+    // DynamicAabbTree over itemCount random boxes: build, moving 1% of the boxes, and
+    // frustum, box, sphere and ray queries against a linear scan of the same boxes.
+    // The error column counts differing query results.
+    std::vector<BenchmarkResult> SpatialQueries(unsigned int itemCount);
+    // Collision pairs of itemCount random spheres: the all-pairs loop against sweep and
+    // prune sorting from scratch and on the next frame, after every sphere moved a little.
+    // The error column counts differing colliding pairs.
+    std::vector<BenchmarkResult> Broadphase(unsigned int itemCount);
+    // Collision pairs of itemCount random spheres at a sparse, a medium and a dense
+    // spacing: the all-pairs loop against sweep and prune and the spatial hash grid.
+    // The error column counts differing colliding pairs.
+    std::vector<BenchmarkResult> GridBroadphase(unsigned int itemCount);
+    // Narrowphase of the candidate pairs of itemCount densely packed random spheres,
+    // serial and with 2 to maxThreads threads, in pairs per second. The error column
+    // counts contacts that differ from the serial run.
+    std::vector<BenchmarkResult> ParallelNarrowphase(unsigned int maxThreads, unsigned int itemCount);
+    // Quickhull of itemCount random points, then the cost per pair of 10000 pairs of
+    // rotated hulls: sphere test, GJK intersection, GJK and EPA, and the narrowphase that
+    // runs them behind the sphere test.
+    // The error column counts points outside the hull, then contacts whose depth fails
+    // to separate the pair when b is moved by it along the normal.
+    std::vector<BenchmarkResult> ConvexHulls(unsigned int itemCount);
+    // Static mesh collider of a terrain with about triangleCount triangles: BVH build, then
+    // 1000 spheres near the surface tested against every triangle and through the BVH,
+    // and the same bodies as hulls. The error column counts differing deepest contacts.
+    std::vector<BenchmarkResult> MeshColliders(unsigned int triangleCount);
+    // Columns of five boxes standing on a ground mesh, about bodyCount boxes, simulated for
+    // one second in fixed steps, in milliseconds per step: without and with warm starting,
+    // then with 2 to maxThreads threads. The error column counts boxes that slid or sank
+    // out of place.
+    std::vector<BenchmarkResult> RigidBodies(unsigned int maxThreads, unsigned int bodyCount);
+    // The same columns after three seconds, when they came to rest, one second in
+    // milliseconds per step: every island awake, with sleeping islands, then every island
+    // awake and solved on 2 to maxThreads threads. The error column counts displaced boxes.
+    std::vector<BenchmarkResult> Islands(unsigned int maxThreads, unsigned int bodyCount);
+}
+
+#endif // !_BENCHMARKS_H_
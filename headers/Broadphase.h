@@ -0,0 +1,39 @@
+#ifndef _BROADPHASE_H_
+#define _BROADPHASE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "FrustumCulling.h"
+
+// Candidate collision pair of body indices, first < second
+struct BodyPair {
+    unsigned int first;
+    unsigned int second;
+};
+
+// Two bodies are tested only if each one's layer bits are in the other's mask
+struct CollisionFilter {
+    static constexpr uint32_t DEFAULT_LAYER = 1;
+    static constexpr uint32_t ALL_LAYERS = ~0u;
+
+    bool ShouldCollide(const CollisionFilter& other) const {
+        return (layer & other.mask) && (other.layer & mask);
+    }
+
+    uint32_t layer = DEFAULT_LAYER;
+    uint32_t mask = ALL_LAYERS;
+};
+
+// Finds the bodies whose world space boxes overlap, so the narrowphase skips the rest
+class Broadphase {
+public:
+    virtual ~Broadphase() = default;
+
+    // Bounds and filters are indexed by body, appends each overlapping pair whose
+    // filters accept each other once
+    virtual void FindPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+        std::vector<BodyPair>& pairs) = 0;
+};
+
+#endif // !_BROADPHASE_H_
@@ -0,0 +1,49 @@
+#ifndef _CONVEX_HULL_H_
+#define _CONVEX_HULL_H_
+
+#include <vector>
+
+#include <SimpleMath.h>
+
+using namespace DirectX::SimpleMath;
+
+// Convex hull of a point set, built with quickhull. Triangles are wound so the right
+// hand rule gives outward normals. Flat or degenerate point sets give an empty hull,
+// collisions then fall back to the bounding sphere.
+struct ConvexHull {
+    // Points are read with a byte stride so they can be taken straight from vertex arrays
+    static ConvexHull FromPoints(const Vector3* points, size_t count, size_t stride = sizeof(Vector3));
+
+    bool IsEmpty() const;
+    // Hull vertex farthest along the direction
+    Vector3 Support(const Vector3& direction) const;
+
+    std::vector<Vector3> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Support mapping of a hull moved into world space by an affine matrix, the form the
+// GJK and EPA queries work on
+struct ConvexShape {
+    ConvexShape(const ConvexHull& hull, const Matrix& worldMatrix);
+
+    Vector3 Support(const Vector3& direction) const;
+
+    const ConvexHull* hull;
+    Matrix worldMatrix;
+    // Brings world directions into hull space, the transpose of the linear part
+    Matrix directionMatrix;
+};
+
+// Gilbert-Johnson-Keerthi distance algorithm and the expanding polytope algorithm on
+// the Minkowski difference of two convex shapes
+namespace Gjk {
+    // True if the shapes overlap
+    bool Intersect(const ConvexShape& a, const ConvexShape& b);
+    // For overlapping shapes, the normal from a towards b along which they separate the
+    // quickest, the depth to move b along it and a point in the middle of the overlap.
+    // False if the shapes don't overlap or the polytope degenerates.
+    bool Penetration(const ConvexShape& a, const ConvexShape& b, Vector3& normal, float& depth, Vector3& point);
+}
+
+#endif // !_CONVEX_HULL_H_
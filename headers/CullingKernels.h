@@ -0,0 +1,45 @@
+#ifndef _CULLING_KERNELS_H_
+#define _CULLING_KERNELS_H_
+
+#include <cstdint>
+
+#include "FrustumCulling.h"
+
+// x64 always has SSE2, AVX is only used when the compiler targets it (/arch:AVX)
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define CULLING_KERNELS_SSE
+#endif
+#if defined(__AVX__)
+#define CULLING_KERNELS_AVX
+#endif
+
+// World space bounding spheres stored as separate float arrays (structure of arrays)
+struct SphereArrays {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+};
+
+// Batched versions of BoundingSphere::IsOnFrustum, every sphere is tested against
+// all six planes. Bit (i % 32) of visibility[i / 32] is set when sphere i is on
+// the frustum, the mask must hold GetMaskWordCount(count) words.
+namespace CullingKernels {
+    unsigned int GetMaskWordCount(unsigned int count);
+    bool IsVisible(const uint32_t* visibility, unsigned int index);
+
+    void TestSpheres(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility);
+
+    void TestSpheresScalar(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility);
+#ifdef CULLING_KERNELS_SSE
+    void TestSpheresSSE(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility);
+#endif
+#ifdef CULLING_KERNELS_AVX
+    void TestSpheresAVX(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility);
+#endif
+
+    // Name of the widest instruction set TestSpheres dispatches to
+    const char* GetInstructionSetName();
+}
+
+#endif // !_CULLING_KERNELS_H_
@@ -21,9 +21,9 @@ namespace DirectX {
 }
 
 void from_json(const nlohmann::json& j, Transform& t) {
-    t.position = j["position"].get<Vector3>();
-    t.rotation = j["rotation"].get<Vector3>();
-    t.scale = j["scale"].get<Vector3>();
+    t.SetPosition(j["position"].get<Vector3>());
+    t.SetRotation(j["rotation"].get<Vector3>());
+    t.SetScale(j["scale"].get<Vector3>());
 }
 
 class Deserializer {
@@ -135,6 +135,13 @@ inline void Deserializer::DeserializeModel(const json& j, Scene* scene) {
         scene->m_Device, 
         j["path"].get<std::string>().c_str(),
         scene->m_Materials[j["material"].get<std::string>()].get());
+    if (j.contains("lods")) {
+        for (const auto& jLod : j["lods"]) {
+            model->AddLod(scene->m_Device,
+                jLod["path"].get<std::string>().c_str(),
+                jLod["screen_size"].get<float>());
+        }
+    }
 
     scene->m_Models.insert({ model->name, std::move(model) });
 }
@@ -176,6 +183,11 @@ void Deserializer::DeserializeSceneNode(SceneNode* parentNode, const json& j, Sc
         scene->m_Lights.insert({ node->name, dynamic_cast<Light*>(node.get()) });
     }
     node->transform = j["transform"];
+    node->occluder = j.value("occluder", false);
+    node->collisionLayer = j.value("collision_layer", node->collisionLayer);
+    node->collisionMask = j.value("collision_mask", node->collisionMask);
+    node->staticMesh = j.value("static_mesh", false);
+    node->mass = j.value("mass", 0.0f);
 
     for (const auto& jNode : j["children"]) {
         DeserializeSceneNode(node.get(), jNode, scene);
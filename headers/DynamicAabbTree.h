@@ -0,0 +1,230 @@
+#ifndef _DYNAMIC_AABB_TREE_H_
+#define _DYNAMIC_AABB_TREE_H_
+
+#include <vector>
+#include <cassert>
+
+#include "FrustumCulling.h"
+
+// Bounding volume hierarchy over axis aligned boxes that supports incremental changes.
+// Leaves (proxies) store a box fattened by a margin, so small movements don't touch
+// the tree. Insertion picks the sibling with the surface area heuristic and the
+// ancestors are rebalanced with AVL style rotations, which keeps the height
+// logarithmic and every query below O(log n + k) for k reported proxies.
+// Queries report proxies whose fat box passes the test, callers refine with the
+// exact bounds. They return the number of visited tree nodes.
+class DynamicAabbTree {
+public:
+    static constexpr int NULL_PROXY = -1;
+
+    DynamicAabbTree(float margin = 0.1f);
+
+    int Insert(const AxisAlignedBox& bounds, void* userData);
+    void Remove(int proxy);
+    // Reinserts the proxy if the bounds left its fat box or got much smaller than it,
+    // returns true in that case
+    bool Update(int proxy, const AxisAlignedBox& bounds);
+    void Clear();
+
+    void* GetUserData(int proxy) const;
+    const AxisAlignedBox& GetFatBounds(int proxy) const;
+    unsigned int GetProxyCount() const;
+    // Zero for a single leaf, -1 for an empty tree
+    int GetHeight() const;
+
+    // callback(int proxy, bool inside), inside is true when the fat box is entirely in the frustum
+    template<typename F>
+    unsigned int QueryFrustum(const Frustum& frustum, F&& callback) const;
+    // callback(int proxy)
+    template<typename F>
+    unsigned int QueryBox(const AxisAlignedBox& box, F&& callback) const;
+    template<typename F>
+    unsigned int QuerySphere(const BoundingSphere& sphere, F&& callback) const;
+    // callback(int proxy, float maxDistance) returns the new maximum distance: the hit
+    // distance to keep only closer hits, maxDistance to ignore the proxy, 0 to stop.
+    // Distances are in units of the direction length.
+    template<typename F>
+    unsigned int RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, F&& callback) const;
+
+private:
+    struct Node {
+        bool IsLeaf() const {
+            return child1 == NULL_PROXY;
+        }
+
+        AxisAlignedBox bounds;
+        void* userData = nullptr;
+        // Next free node while on the free list
+        int parent = NULL_PROXY;
+        int child1 = NULL_PROXY;
+        int child2 = NULL_PROXY;
+        // Leaves are at height 0, free nodes at -1
+        int height = -1;
+    };
+
+    int AllocateNode();
+    void FreeNode(int index);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    // Refits the ancestors of index up to the root, rotating where the heights differ by more than one
+    void RefitAncestors(int index);
+    int Balance(int index);
+
+    template<typename F>
+    void ForEachLeaf(int index, F&& callback, unsigned int& visited) const;
+
+private:
+    // Traversals keep at most height + 1 entries on the stack
+    static constexpr int STACK_SIZE = 256;
+
+    std::vector<Node> m_Nodes;
+    int m_Root = NULL_PROXY;
+    int m_FreeList = NULL_PROXY;
+    unsigned int m_ProxyCount = 0;
+    float m_Margin;
+};
+
+template<typename F>
+void DynamicAabbTree::ForEachLeaf(int index, F&& callback, unsigned int& visited) const {
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = index;
+    while (stackSize > 0) {
+        const int current = stack[--stackSize];
+        const Node& node = m_Nodes[current];
+        visited++;
+        if (node.IsLeaf()) {
+            callback(current);
+            continue;
+        }
+        assert(stackSize + 2 <= STACK_SIZE);
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+}
+
+template<typename F>
+unsigned int DynamicAabbTree::QueryFrustum(const Frustum& frustum, F&& callback) const {
+    unsigned int visited = 0;
+    if (m_Root == NULL_PROXY) {
+        return visited;
+    }
+
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = m_Root;
+    while (stackSize > 0) {
+        const int index = stack[--stackSize];
+        const Node& node = m_Nodes[index];
+        visited++;
+        const FrustumIntersection intersection = node.bounds.Classify(frustum);
+        if (intersection == FrustumIntersection::Outside) {
+            continue;
+        }
+        if (intersection == FrustumIntersection::Inside) {
+            // Counted again by ForEachLeaf
+            visited--;
+            ForEachLeaf(index, [&](int proxy) { callback(proxy, true); }, visited);
+            continue;
+        }
+        if (node.IsLeaf()) {
+            callback(index, false);
+            continue;
+        }
+        assert(stackSize + 2 <= STACK_SIZE);
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+    return visited;
+}
+
+template<typename F>
+unsigned int DynamicAabbTree::QueryBox(const AxisAlignedBox& box, F&& callback) const {
+    unsigned int visited = 0;
+    if (m_Root == NULL_PROXY) {
+        return visited;
+    }
+
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = m_Root;
+    while (stackSize > 0) {
+        const int index = stack[--stackSize];
+        const Node& node = m_Nodes[index];
+        visited++;
+        if (!node.bounds.Overlaps(box)) {
+            continue;
+        }
+        if (node.IsLeaf()) {
+            callback(index);
+            continue;
+        }
+        assert(stackSize + 2 <= STACK_SIZE);
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+    return visited;
+}
+
+template<typename F>
+unsigned int DynamicAabbTree::QuerySphere(const BoundingSphere& sphere, F&& callback) const {
+    unsigned int visited = 0;
+    if (m_Root == NULL_PROXY) {
+        return visited;
+    }
+
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = m_Root;
+    while (stackSize > 0) {
+        const int index = stack[--stackSize];
+        const Node& node = m_Nodes[index];
+        visited++;
+        if (!node.bounds.Overlaps(sphere)) {
+            continue;
+        }
+        if (node.IsLeaf()) {
+            callback(index);
+            continue;
+        }
+        assert(stackSize + 2 <= STACK_SIZE);
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+    return visited;
+}
+
+template<typename F>
+unsigned int DynamicAabbTree::RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, F&& callback) const {
+    unsigned int visited = 0;
+    if (m_Root == NULL_PROXY) {
+        return visited;
+    }
+
+    const Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    int stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = m_Root;
+    while (stackSize > 0) {
+        const int index = stack[--stackSize];
+        const Node& node = m_Nodes[index];
+        visited++;
+        float distance;
+        if (!node.bounds.IntersectRay(origin, inverseDirection, maxDistance, distance)) {
+            continue;
+        }
+        if (node.IsLeaf()) {
+            maxDistance = callback(index, maxDistance);
+            if (maxDistance <= 0.0f) {
+                break;
+            }
+            continue;
+        }
+        assert(stackSize + 2 <= STACK_SIZE);
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+    return visited;
+}
+
+#endif // !_DYNAMIC_AABB_TREE_H_
@@ -0,0 +1,46 @@
+#ifndef _ENGINE_SETTINGS_H_
+#define _ENGINE_SETTINGS_H_
+
+// Runtime switches between alternative engine code paths, editable from the GUI
+struct EngineSettings {
+    // Propagate transforms through the flattened TransformHierarchy
+    // instead of recursing through the SceneNode tree
+    bool flatTransformHierarchy = true;
+    // Split each depth level of the flat hierarchy across the job system workers
+    bool parallelTransforms = true;
+    // Test the render queue in chunks across the job system workers
+    bool parallelCulling = true;
+    // Gather the render queue from the dynamic AABB tree instead of walking the scene graph
+    bool spatialTreeCulling = false;
+    // Reuse last frame's culling results per node (rejecting plane first,
+    // skip nodes that stayed well inside) instead of the SIMD batch test
+    bool temporalCulling = false;
+    // Test the oriented bounding box of models whose bounding sphere passed
+    bool boxCulling = true;
+    // Test each mesh of a visible model made of several meshes
+    bool meshCulling = true;
+    // Test visible models against a software depth buffer of the occluder nodes
+    bool occlusionCulling = true;
+    // Draw coarser levels of detail of models that are small on screen
+    bool lodSelection = true;
+    // Models whose bounding sphere projects below this many pixels aren't drawn, 0 disables it
+    float smallObjectPixels = 1.0f;
+    // Find collision candidates with the spatial hash grid instead of sweep and prune
+    bool spatialHashBroadphase = false;
+    float gridCellSize = 2.0f;
+    // Split the exact collision tests across the job system workers
+    bool parallelNarrowphase = true;
+    // Move the bodies with mass, in fixed steps of physicsTimestep seconds whatever the frame time
+    bool simulateRigidBodies = true;
+    float physicsTimestep = 1.0f / 60.0f;
+    // Sequential impulse passes over the contacts per step
+    int solverIterations = 8;
+    // Start each contact from the impulses it ended the previous step with
+    bool warmStarting = true;
+    // Islands of bodies at rest stop being simulated until something touches them
+    bool sleeping = true;
+    // Solve independent islands on the job system workers
+    bool parallelIslands = true;
+};
+
+#endif // !_ENGINE_SETTINGS_H_
@@ -0,0 +1,42 @@
+#ifndef _FRAME_STATISTICS_H_
+#define _FRAME_STATISTICS_H_
+
+// Per-frame counters, reset at the start of each Scene::Render. The GUI is built
+// in between, so it shows the update counters of the current frame and the
+// render counters of the previous one.
+struct FrameStatistics {
+    static constexpr unsigned int MAX_LOD_COUNT = 4;
+
+    void Reset() {
+        *this = FrameStatistics();
+    }
+
+    unsigned int recomputedTransforms = 0;
+
+    unsigned int sceneNodes = 0;
+    // Nodes reached by the culling traversal
+    unsigned int visitedNodes = 0;
+    // Subtrees rejected with a single test
+    unsigned int culledSubtrees = 0;
+    // Models left for the batch frustum test
+    unsigned int batchTestedModels = 0;
+    // Sphere and box against plane tests spent on those models
+    unsigned int planeTests = 0;
+    // Models whose sphere is on the frustum but whose box is not
+    unsigned int boxCulledModels = 0;
+    // Occluder triangles drawn into the occlusion buffer
+    unsigned int occluderTriangles = 0;
+    // Models on the frustum hidden behind the occluders
+    unsigned int occludedModels = 0;
+    // Models projected smaller than the pixel threshold
+    unsigned int smallCulledModels = 0;
+    unsigned int renderedModels = 0;
+    // Meshes of visible multi-mesh models tested on their own, and the rejected ones
+    unsigned int testedMeshes = 0;
+    unsigned int culledMeshes = 0;
+    // Rendered models and submitted triangles per level of detail
+    unsigned int lodModels[MAX_LOD_COUNT] = {};
+    unsigned int lodTriangles[MAX_LOD_COUNT] = {};
+};
+
+#endif // !_FRAME_STATISTICS_H_
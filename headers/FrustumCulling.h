@@ -1,31 +1,124 @@
 #ifndef _FRUSTUM_CULLING_H_
 #define _FRUSTUM_CULLING_H_
 
+#include <cstdint>
+
 #include <SimpleMath.h>
 
 using namespace DirectX::SimpleMath;
 
 class Camera;
+class Transform;
+
+enum class FrustumIntersection {
+    Outside,
+    Intersecting,
+    Inside
+};
 
 struct Frustum {
+    static constexpr unsigned int PLANE_COUNT = 6;
+
     Frustum(Camera& camera, float aspectRatio, float zNear, float zFar);
 
+    // Planes in test order: left, right, far, near, top, bottom
+    const Plane& GetPlane(unsigned int index) const;
+    // Upper bound on how much the signed distance to any plane changed since the previous
+    // frustum, for every point inside the previous one. The change is affine in the point,
+    // so its largest magnitude over the previous volume is reached at one of its corners.
+    float GetMaxPlaneShift(const Frustum& previous) const;
+
     Plane top;
     Plane bottom;
     Plane right;
     Plane left;
     Plane farP;
     Plane nearP;
+
+    // Near corners followed by far corners
+    Vector3 corners[8];
+};
+
+// Frame to frame culling state of one bounding sphere
+struct CullingState {
+    // Plane that rejected the sphere at the last full test, it is tested first next time
+    uint8_t lastRejectingPlane = 0;
+    // The sphere was fully inside at the last full test, cleared when the sphere moves
+    bool inside = false;
+    // Smallest distance from the sphere to a plane at that test
+    float margin = 0.0f;
+    // Accumulated frustum shift at that test
+    double shift = 0.0;
 };
 
 struct BoundingSphere {
     BoundingSphere();
     BoundingSphere(Vector3 _center, float _radius);
-    bool IsOnFrustum(const Frustum& camFrustum, Matrix& globalMatrix) const;
-    bool IsOnForwardPlane(const Plane& camPlane);
+    // Smaller of Ritter's sphere and the sphere around the box midpoint, points are
+    // read with a byte stride so they can be taken straight from vertex arrays
+    static BoundingSphere FromPoints(const Vector3* points, size_t count, size_t stride = sizeof(Vector3));
+    // Model space sphere moved into the world space of the transform
+    BoundingSphere Transformed(const Transform& transform) const;
+    // Same for an arbitrary affine matrix, the radius grows by its largest axis scale
+    BoundingSphere Transformed(const Matrix& matrix) const;
+    bool IsOnFrustum(const Frustum& camFrustum, const Transform& transform) const;
+    // For spheres already in world space
+    bool IsOnFrustum(const Frustum& camFrustum) const;
+    bool IsOnForwardPlane(const Plane& camPlane) const;
+    // Same result as IsOnFrustum, but starts with the plane that rejected the sphere
+    // last time and skips the test while the sphere was fully inside and the frustum
+    // has shifted less than the margin since. totalShift accumulates GetMaxPlaneShift
+    // over the frames, planeTests is incremented for every plane tested.
+    bool IsOnFrustum(const Frustum& camFrustum, CullingState& state, double totalShift, unsigned int& planeTests) const;
+    // Inside means no further test is needed for anything enclosed by the sphere
+    FrustumIntersection Classify(const Frustum& camFrustum) const;
+
+    // Smallest sphere enclosing both
+    static BoundingSphere Merge(const BoundingSphere& a, const BoundingSphere& b);
 
     Vector3 center;
     float radius;
 };
 
+// Box given by its center and three half axes. The axes don't have to be orthogonal
+// or unit length, so a box moved by any affine transform is still represented exactly,
+// including non-uniform scale.
+struct OrientedBox {
+    OrientedBox();
+    OrientedBox(Vector3 _center, Vector3 halfAxisX, Vector3 halfAxisY, Vector3 halfAxisZ);
+    // Axis aligned or principal component box of the points, whichever has less volume
+    static OrientedBox FromPoints(const Vector3* points, size_t count, size_t stride = sizeof(Vector3));
+
+    OrientedBox Transformed(const Matrix& matrix) const;
+    // Same plane-by-plane test as BoundingSphere::IsOnFrustum, with the box's
+    // projected extent along each plane normal in place of the radius
+    bool IsOnFrustum(const Frustum& camFrustum) const;
+    float GetVolume() const;
+
+    Vector3 center;
+    Vector3 halfAxes[3];
+};
+
+// World axis aligned box, the node volume of DynamicAabbTree
+struct AxisAlignedBox {
+    AxisAlignedBox();
+    AxisAlignedBox(Vector3 _lower, Vector3 _upper);
+    static AxisAlignedBox FromSphere(const BoundingSphere& sphere);
+    static AxisAlignedBox FromBox(const OrientedBox& box);
+    static AxisAlignedBox Union(const AxisAlignedBox& a, const AxisAlignedBox& b);
+
+    AxisAlignedBox Expanded(float margin) const;
+    bool Contains(const AxisAlignedBox& other) const;
+    bool Overlaps(const AxisAlignedBox& other) const;
+    bool Overlaps(const BoundingSphere& sphere) const;
+    // Entry distance along the ray in units of the direction length, the inverse
+    // direction is passed in so it's computed once per ray
+    bool IntersectRay(const Vector3& origin, const Vector3& inverseDirection, float maxDistance, float& distance) const;
+    FrustumIntersection Classify(const Frustum& camFrustum) const;
+    float GetSurfaceArea() const;
+
+    Vector3 lower;
+    Vector3 upper;
+};
+
 #endif // !_FRUSTUM_CULLING_H_
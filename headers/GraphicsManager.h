@@ -22,6 +22,8 @@
 #include "Camera.h"
 #include "Light.h"
 #include "Scene.h"
+#include "EngineSettings.h"
+#include "JobSystem.h"
 
 // Globals
 const bool FULL_SCREEN = false;
@@ -50,6 +52,7 @@ private:
     std::unique_ptr<D3D11Manager> m_d3d;
     std::unique_ptr<PhysicsManager> m_Physics;
     std::unique_ptr<ScriptingManager> m_Scripting;
+    std::unique_ptr<JobSystem> m_Jobs;
 
     HWND m_hWnd;
     std::unique_ptr<DirectX::Keyboard> m_Keyboard;
@@ -58,6 +61,7 @@ private:
     std::unique_ptr<GuiManager> m_Gui;
 
     std::unique_ptr<Scene> m_Scene;
+    EngineSettings m_Settings;
 };
 
 #endif // !_GRAPHICS_MANAGER_H_
\ No newline at end of file
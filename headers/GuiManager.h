@@ -10,6 +10,11 @@
 #include "SceneNode.h"
 #include "Camera.h"
 #include "Light.h"
+#include "FrameStatistics.h"
+#include "CullingKernels.h"
+#include "EngineSettings.h"
+#include "Benchmarks.h"
+#include "JobSystem.h"
 
 class GuiManager {
 public:
@@ -71,7 +76,7 @@ public:
         ImGui::DestroyContext();
     }
 
-    void Update(const SceneNode* node, const PhysicsManager* physMgr) {
+    void Update(const SceneNode* node, const PhysicsManager* physMgr, const FrameStatistics& stats, EngineSettings& settings) {
         // Start the Dear ImGui frame
         ImGui_ImplDX11_NewFrame();
         ImGui_ImplWin32_NewFrame();
@@ -151,15 +156,158 @@ public:
             //ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_SpanAvailWidth;
             //ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(2, 2));
 
-            ImGui::Text("Collisions:");
-            for (auto& collisionPair : physMgr->collisions) {
-                ImGui::BulletText((collisionPair.first + " - " + collisionPair.second).c_str());
-                ImGui::Separator();
+            const PairCache& contacts = physMgr->GetContacts();
+            ImGui::Text("Collisions: %u (%u ended this frame)", contacts.GetContactCount(), static_cast<unsigned int>(contacts.GetEndContacts().size()));
+            for (const std::vector<ContactPair>* list : { &contacts.GetBeginContacts(), &contacts.GetPersistContacts() }) {
+                for (const ContactPair& contact : *list) {
+                    const SceneNode* first = physMgr->FindBody(contact.first);
+                    const SceneNode* second = physMgr->FindBody(contact.second);
+                    ImGui::BulletText("%s - %s", first->name.c_str(), second->name.c_str());
+                    ImGui::Separator();
+                }
             }
 
             ImGui::End();
         }
 
+        {
+            if (!ImGui::Begin("Frame statistics", &stats_pane)) {
+                ImGui::End();
+                return;
+            }
+
+            ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            ImGui::Text("Recomputed transforms: %u", stats.recomputedTransforms);
+            ImGui::Text("Visited nodes: %u / %u", stats.visitedNodes, stats.sceneNodes);
+            ImGui::Text("Culled subtrees: %u", stats.culledSubtrees);
+            ImGui::Text("Batch tested models: %u (%s)", stats.batchTestedModels, CullingKernels::GetInstructionSetName());
+            ImGui::Text("Plane tests: %u", stats.planeTests);
+            ImGui::Text("Box culled models: %u", stats.boxCulledModels);
+            ImGui::Text("Occluder triangles: %u", stats.occluderTriangles);
+            ImGui::Text("Occluded models: %u", stats.occludedModels);
+            ImGui::Text("Rendered models: %u", stats.renderedModels);
+            ImGui::Text("Culled meshes: %u / %u", stats.culledMeshes, stats.testedMeshes);
+            ImGui::Text("Small culled models: %u", stats.smallCulledModels);
+            for (unsigned int lod = 0; lod < FrameStatistics::MAX_LOD_COUNT; lod++) {
+                ImGui::Text("LOD %u: %u models, %u triangles", lod, stats.lodModels[lod], stats.lodTriangles[lod]);
+            }
+
+            ImGui::Separator();
+            ImGui::Checkbox("Flat transform hierarchy", &settings.flatTransformHierarchy);
+            ImGui::Checkbox("Parallel transform update", &settings.parallelTransforms);
+            ImGui::Checkbox("Parallel culling", &settings.parallelCulling);
+            ImGui::Checkbox("AABB tree culling", &settings.spatialTreeCulling);
+            ImGui::Checkbox("Temporal coherence culling", &settings.temporalCulling);
+            ImGui::Checkbox("Bounding box culling", &settings.boxCulling);
+            ImGui::Checkbox("Per mesh culling", &settings.meshCulling);
+            ImGui::Checkbox("Occlusion culling", &settings.occlusionCulling);
+            ImGui::Checkbox("Level of detail", &settings.lodSelection);
+            ImGui::SliderFloat("Small object pixels", &settings.smallObjectPixels, 0.0f, 16.0f);
+            ImGui::Checkbox("Spatial hash broadphase", &settings.spatialHashBroadphase);
+            ImGui::SliderFloat("Grid cell size", &settings.gridCellSize, 0.25f, 16.0f);
+            ImGui::Checkbox("Parallel narrowphase", &settings.parallelNarrowphase);
+            ImGui::Checkbox("Simulate rigid bodies", &settings.simulateRigidBodies);
+            ImGui::SliderInt("Solver iterations", &settings.solverIterations, 1, 32);
+            ImGui::Checkbox("Warm starting", &settings.warmStarting);
+            ImGui::Checkbox("Sleeping islands", &settings.sleeping);
+            ImGui::Checkbox("Parallel islands", &settings.parallelIslands);
+
+            ImGui::End();
+        }
+
+        {
+            if (!ImGui::Begin("Benchmarks", &benchmark_pane)) {
+                ImGui::End();
+                return;
+            }
+
+            // Benchmarks run synchronously, the frame stalls until they finish
+            const unsigned int maxThreads = JobSystem::GetDefaultWorkerThreadCount() + 1;
+            if (ImGui::Button("Job system scaling")) {
+                benchmarkResults = Benchmarks::JobSystemScaling(maxThreads, 1 << 20);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Transform update")) {
+                benchmarkResults = Benchmarks::TransformUpdate(maxThreads, 100000);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Local matrix kernels")) {
+                benchmarkResults = Benchmarks::LocalMatrixKernels(1 << 20);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Frustum culling kernels")) {
+                benchmarkResults = Benchmarks::FrustumCullingKernels(1 << 20);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Parallel culling")) {
+                benchmarkResults = Benchmarks::ParallelCulling(maxThreads, 200000);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Occlusion culling")) {
+                benchmarkResults = Benchmarks::OcclusionCulling(10000);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Spatial queries")) {
+                benchmarkResults.clear();
+                for (unsigned int itemCount : { 10000u, 100000u, 1000000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::SpatialQueries(itemCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Broadphase")) {
+                benchmarkResults.clear();
+                for (unsigned int itemCount : { 1000u, 10000u, 50000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::Broadphase(itemCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Grid broadphase")) {
+                benchmarkResults = Benchmarks::GridBroadphase(10000);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Parallel narrowphase")) {
+                benchmarkResults = Benchmarks::ParallelNarrowphase(maxThreads, 200000);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Convex hulls")) {
+                benchmarkResults.clear();
+                for (unsigned int itemCount : { 1000u, 100000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::ConvexHulls(itemCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Mesh colliders")) {
+                benchmarkResults.clear();
+                for (unsigned int triangleCount : { 10000u, 100000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::MeshColliders(triangleCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Rigid bodies")) {
+                benchmarkResults.clear();
+                for (unsigned int bodyCount : { 1000u, 10000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::RigidBodies(maxThreads, bodyCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Islands")) {
+                benchmarkResults.clear();
+                for (unsigned int bodyCount : { 1000u, 10000u }) {
+                    const std::vector<BenchmarkResult> results = Benchmarks::Islands(maxThreads, bodyCount);
+                    benchmarkResults.insert(benchmarkResults.end(), results.begin(), results.end());
+                }
+            }
+
+            ShowBenchmarkResults();
+
+            ImGui::End();
+        }
+
         if (selectedNode) {
             if (!ImGui::Begin("Node Properties", &node_pane)) {
                 ImGui::End();
@@ -170,21 +318,21 @@ public:
 
             float v[3] = { selectedNode->transform.position.x, selectedNode->transform.position.y, selectedNode->transform.position.z };
             if (ImGui::InputFloat3("Position", v)) {
-                selectedNode->transform.position = Vector3(v[0], v[1], v[2]);
+                selectedNode->transform.SetPosition(Vector3(v[0], v[1], v[2]));
             }
           
             v[0] = selectedNode->transform.rotation.x;
             v[1] = selectedNode->transform.rotation.y;
             v[2] = selectedNode->transform.rotation.z;
             if (ImGui::SliderFloat3("Rotation", v, 0.f, DirectX::XM_2PI)) {
-                selectedNode->transform.rotation = Vector3(v[0], v[1], v[2]);
+                selectedNode->transform.SetRotation(Vector3(v[0], v[1], v[2]));
             }
 
             v[0] = selectedNode->transform.scale.x;
             v[1] = selectedNode->transform.scale.y;
             v[2] = selectedNode->transform.scale.z;
             if (ImGui::SliderFloat3("Scale", v, 0.f, 10.f)) {
-                selectedNode->transform.scale = Vector3(v[0], v[1], v[2]);
+                selectedNode->transform.SetScale(Vector3(v[0], v[1], v[2]));
             }
 
             if (selectedNode->GetType() == "camera") {
@@ -228,7 +376,9 @@ public:
         }
     }
 
-    void ShowNode(SceneNode* node, ImGuiTreeNodeFlags flags) {
+    // Nodes below a rejected subtree are not visited by the culling pass,
+    // they are shown culled through their ancestor
+    void ShowNode(SceneNode* node, ImGuiTreeNodeFlags flags, bool ancestorCulled = false) {
         ImGui::PushID(node);
 
         ImGuiTreeNodeFlags localFlags = flags;
@@ -239,7 +389,7 @@ public:
             localFlags |= ImGuiTreeNodeFlags_Leaf;
         }
         
-        if (node->culled)
+        if (ancestorCulled || node->culled)
             ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 0, 0, 255));
         else
             ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32_WHITE);
@@ -255,7 +405,7 @@ public:
             int i = 0;
             for (const auto& child : node->children) {
                 ImGui::PushID(i);
-                ShowNode(child.get(), flags);
+                ShowNode(child.get(), flags, ancestorCulled || node->subtreeCulled);
                 i++;
                 ImGui::PopID();
             }
@@ -269,6 +419,39 @@ public:
             selected = i;*/
     }
 
+    void ShowBenchmarkResults() {
+        if (benchmarkResults.empty()) {
+            return;
+        }
+
+        if (ImGui::BeginTable("Benchmark results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Benchmark");
+            ImGui::TableSetupColumn("Threads");
+            ImGui::TableSetupColumn("Items");
+            ImGui::TableSetupColumn("Time (ms)");
+            ImGui::TableSetupColumn("Speedup");
+            ImGui::TableSetupColumn("Error");
+            ImGui::TableHeadersRow();
+
+            for (const BenchmarkResult& result : benchmarkResults) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", result.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", result.threads);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", result.items);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", result.milliseconds);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2fx", result.speedup);
+                ImGui::TableNextColumn();
+                ImGui::Text("%g", result.maxError);
+            }
+            ImGui::EndTable();
+        }
+    }
+
     void Render() {
         ImGui::Render();
         ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
@@ -289,6 +472,9 @@ private:
     bool hierarchy_pane = true;
     bool node_pane = true;
     bool collision_pane = true;
+    bool stats_pane = true;
+    bool benchmark_pane = true;
+    std::vector<BenchmarkResult> benchmarkResults;
     SceneNode* selectedNode;
 };
 
@@ -0,0 +1,95 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Tracks a group of jobs. Jobs scheduled with RunAfter on a counter start
+// once every job added to that counter has finished.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const;
+
+private:
+    struct Continuation {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    std::atomic<unsigned int> m_Pending{ 0 };
+    std::mutex m_Mutex;
+    std::vector<Continuation> m_Continuations;
+
+    friend class JobSystem;
+};
+
+// Task scheduler with one deque per worker and work stealing.
+// Workers pop their own jobs from the back and steal from the front of the others.
+// The thread that owns the JobSystem takes part in the work while it waits.
+class JobSystem {
+public:
+    // workerThreads == 0 runs every job on the waiting thread
+    explicit JobSystem(unsigned int workerThreads);
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem();
+
+    static unsigned int GetDefaultWorkerThreadCount();
+
+    void Run(std::function<void()> job, JobCounter* counter = nullptr);
+    // Starts job once every job tracked by dependency has finished
+    void RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter = nullptr);
+    // Executes pending jobs until the counter reaches zero
+    void Wait(JobCounter& counter);
+
+    // Splits [0, count) into chunks of at most grainSize and runs body(begin, end) on each,
+    // returns once all chunks are done
+    void ParallelFor(unsigned int count, unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& body);
+
+    // Worker threads plus the waiting thread
+    unsigned int GetThreadCount() const;
+    // Index of the calling thread in [0, GetThreadCount()), 0 for threads outside the system
+    unsigned int GetCurrentThreadIndex() const;
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void Submit(Job job);
+    bool TryExecuteJob(unsigned int queueIndex);
+    bool PopJob(unsigned int queueIndex, Job& job);
+    void FinishJob(JobCounter* counter);
+    void WorkerLoop(unsigned int queueIndex);
+
+private:
+    // Queue 0 belongs to the threads outside the system, queue i to worker thread i
+    std::vector<std::unique_ptr<WorkerQueue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+
+    std::atomic<unsigned int> m_QueuedJobs{ 0 };
+    std::atomic<unsigned int> m_NextQueue{ 0 };
+    std::mutex m_WakeMutex;
+    std::condition_variable m_WakeCondition;
+    bool m_Stop = false;
+};
+
+#endif // !_JOB_SYSTEM_H_
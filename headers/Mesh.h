@@ -3,6 +3,7 @@
 
 #include <d3d11.h>
 #include "Transform.h"
+#include "FrustumCulling.h"
 
 #include <vector>
 
@@ -26,6 +27,7 @@ public:
 
     int GetIndexCount() const;
     const std::vector<Vertex>& GetVertices() const;
+    const std::vector<unsigned int>& GetIndices() const;
 
 private:
     bool InitializeBuffers(ID3D11Device*);
@@ -33,6 +35,9 @@ private:
 
 public:
     Transform transform;
+    // Bounds of the vertex positions, before the mesh transform
+    BoundingSphere boundingSphere;
+    OrientedBox boundingBox;
 
 private:
     std::vector<Vertex> m_Vertices;
@@ -11,28 +11,74 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "FrustumCulling.h"
+#include "ConvexHull.h"
+#include "TriangleMesh.h"
+
+// Optional second culling stage of Model::Render, the meshes of a visible model
+// are tested one by one against the frustum
+struct MeshCulling {
+    const Frustum* frustum = nullptr;
+    bool boxCulling = true;
+    unsigned int testedMeshes = 0;
+    unsigned int culledMeshes = 0;
+    // Triangles of the meshes that were drawn
+    unsigned int submittedTriangles = 0;
+};
+
+// One level of detail, level 0 is the model itself and each next one is coarser
+struct ModelLod {
+    std::vector<Mesh> meshes;
+    std::string path;
+    // The level is drawn once the projected size drops below this fraction of the screen height
+    float screenSize = 0.0f;
+    unsigned int triangleCount = 0;
+};
 
 class Model {
 public:
+    static constexpr unsigned int MAX_LOD_COUNT = 4;
+    // Relative widening of the switch thresholds in the direction away from the
+    // current level, so a model at a threshold doesn't pop between two levels
+    static constexpr float LOD_HYSTERESIS = 0.1f;
+
     bool Initialize(std::string, ID3D11Device*, const char*);
     bool Initialize(std::string, ID3D11Device*, const char*, Material*);
-    void InitializeBoundingSphere();
+    // Appends a coarser level, false if its screen size isn't below the one of the previous level
+    bool AddLod(ID3D11Device*, const char*, float);
+    // Bounds of level 0, the coarser levels are expected to fit in them
+    void InitializeBounds();
     void Shutdown();
 
-    bool Render(ID3D11DeviceContext*, ShaderPayload*, Matrix) const;
+    bool Render(ID3D11DeviceContext*, ShaderPayload*, Matrix, MeshCulling* = nullptr, unsigned int = 0) const;
     void SetMaterial(Material*);
+    const std::vector<Mesh>& GetMeshes(unsigned int = 0) const;
+    unsigned int GetLodCount() const;
+    unsigned int GetTriangleCount(unsigned int = 0) const;
+    // Picks the level for a projected size, starting from the level drawn last frame
+    unsigned int SelectLod(float, unsigned int) const;
+
+    // Fraction of the screen height covered by the diameter of a world space sphere,
+    // larger than 1 when the camera is inside it
+    static float GetScreenSize(const BoundingSphere&, const Matrix&, const Matrix&);
 
 private:
     bool ImportModel(const char*);
+    bool InitializeLod(ModelLod&, ID3D11Device*);
     void LoadNode(aiNode*, const aiScene*, aiMatrix4x4);
     void LoadMesh(aiMesh*, const aiScene*, aiMatrix4x4, aiMatrix4x4);
+    static bool IsMeshVisible(const Mesh&, const Matrix&, const MeshCulling&);
 
 public:
     std::string name;
     BoundingSphere boundingSphere;
+    OrientedBox boundingBox;
+    // Hull of level 0 in model space for the narrowphase, empty for flat models
+    ConvexHull collisionHull;
+    // Triangles of level 0 in model space, used by nodes that collide as static meshes
+    TriangleMesh collisionMesh;
 
 private:
-    std::vector<Mesh> m_Meshes;
+    std::vector<ModelLod> m_Lods;
     Material* m_Material;
 
     std::string m_Path;
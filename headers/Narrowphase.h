@@ -0,0 +1,69 @@
+#ifndef _NARROWPHASE_H_
+#define _NARROWPHASE_H_
+
+#include <vector>
+
+#include <SimpleMath.h>
+
+#include "Broadphase.h"
+#include "ConvexHull.h"
+#include "TriangleMesh.h"
+
+using namespace DirectX::SimpleMath;
+
+class JobSystem;
+
+// Touching pair of bodies with the data a solver needs
+struct Contact {
+    // Body indices of the candidate pair, first < second
+    unsigned int first;
+    unsigned int second;
+    // Unit vector from the first body towards the second
+    Vector3 normal;
+    // Midpoint of the overlap along the normal
+    Vector3 point;
+    float depth;
+};
+
+// What the narrowphase knows of a body. Bodies with a hull are tested with GJK and EPA
+// once their spheres overlap, the rest stop at the sphere test. Static mesh bodies are
+// tested triangle by triangle against the others and never against each other.
+struct CollisionBody {
+    BoundingSphere sphere;
+    // Model space hull placed by the world matrix, nullptr if the body has none
+    const ConvexHull* hull;
+    Matrix worldMatrix;
+    // Model space triangles placed by the world matrix, nullptr unless the body is a static mesh
+    const TriangleMesh* mesh = nullptr;
+};
+
+// Exact tests of the broadphase candidates. With a job system the pairs are split into
+// fixed size chunks, each filling its own contact buffer, and the buffers are appended
+// in chunk order, so the contacts come out in pair order for any number of threads.
+class Narrowphase {
+public:
+    void Run(const std::vector<CollisionBody>& bodies, const std::vector<BodyPair>& pairs, JobSystem* jobs = nullptr);
+
+    const std::vector<Contact>& GetContacts() const;
+
+    // Contact of two spheres, false if they don't overlap
+    static bool TestSpheres(const BoundingSphere& a, const BoundingSphere& b, Contact& contact);
+    // Contact of a sphere and a triangle, with the normal pointing from the triangle to the sphere
+    static bool TestSphereTriangle(const BoundingSphere& sphere, const Vector3& a, const Vector3& b, const Vector3& c, Contact& contact);
+    // Sphere test as an early out, then the hulls if both bodies have one
+    static bool TestBodies(const CollisionBody& a, const CollisionBody& b, Contact& contact);
+    // Deepest contact of the body with the triangles near it, normal from the mesh to the body
+    static bool TestMesh(const CollisionBody& meshBody, const CollisionBody& body, Contact& contact);
+
+private:
+    static void TestRange(const std::vector<CollisionBody>& bodies, const std::vector<BodyPair>& pairs,
+        unsigned int begin, unsigned int end, std::vector<Contact>& contacts);
+
+private:
+    static constexpr unsigned int PARALLEL_GRAIN_SIZE = 4096;
+
+    std::vector<std::vector<Contact>> m_ChunkContacts;
+    std::vector<Contact> m_Contacts;
+};
+
+#endif // !_NARROWPHASE_H_
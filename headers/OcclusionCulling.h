@@ -0,0 +1,66 @@
+#ifndef _OCCLUSION_CULLING_H_
+#define _OCCLUSION_CULLING_H_
+
+#include <vector>
+#include <cstdint>
+
+#include <SimpleMath.h>
+
+#include "FrustumCulling.h"
+#include "CullingKernels.h"
+
+using namespace DirectX::SimpleMath;
+
+// Low resolution software depth buffer for occlusion culling. A few large occluders
+// are rasterized on the CPU, the depth is reduced into a hierarchical-Z pyramid that
+// keeps the farthest depth of each texel, and occludee boxes are tested against the
+// level where their screen rectangle covers at most 4x4 texels.
+// Depth follows the D3D convention, 0 on the near plane and 1 on the far plane.
+class OcclusionBuffer {
+public:
+    static constexpr unsigned int DEFAULT_WIDTH = 256;
+    static constexpr unsigned int DEFAULT_HEIGHT = 128;
+
+    // The width is rounded up to a multiple of 4 for the SIMD rasterizer
+    OcclusionBuffer(unsigned int width = DEFAULT_WIDTH, unsigned int height = DEFAULT_HEIGHT);
+
+    // Starts a frame, clears the depth to the far plane
+    void Clear(const Matrix& viewProjection);
+    // Rasterizes an indexed triangle list with both faces, positions are read with a byte stride
+    void RasterizeTriangles(const Vector3* positions, size_t vertexCount, size_t stride,
+        const unsigned int* indices, size_t indexCount, const Matrix& worldMatrix);
+    // Reduces the depth buffer into the coarser levels, call after the last occluder
+    void BuildHierarchy();
+    // False only if the box is completely hidden behind the rasterized occluders
+    bool IsVisible(const OrientedBox& worldBox) const;
+
+    unsigned int GetWidth() const;
+    unsigned int GetHeight() const;
+    unsigned int GetLevelCount() const;
+    float GetDepth(unsigned int level, unsigned int x, unsigned int y) const;
+    unsigned int GetRasterizedTriangleCount() const;
+
+private:
+    struct Level {
+        unsigned int width;
+        unsigned int height;
+        std::vector<float> depth;
+    };
+
+    struct ClipVertex {
+        float x, y, z, w;
+    };
+
+    // Clips against the near plane and splits the result into triangles
+    void RasterizeClipped(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+    void RasterizeTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+    static ClipVertex ToClipSpace(const Vector3& position, const Matrix& matrix);
+
+private:
+    std::vector<Level> m_Levels;
+    Matrix m_ViewProjection;
+    std::vector<ClipVertex> m_ClipVertices;
+    unsigned int m_RasterizedTriangles = 0;
+};
+
+#endif // !_OCCLUSION_CULLING_H_
@@ -0,0 +1,72 @@
+#ifndef _PAIR_CACHE_H_
+#define _PAIR_CACHE_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Two scene node ids in contact, first < second
+struct ContactPair {
+    unsigned int first;
+    unsigned int second;
+};
+
+// Open addressing hash set of packed id pairs with linear probing. Slots live in one
+// array and the inserted keys are also kept in order, so clearing and iterating only
+// touch the keys in the set and nothing is allocated once the capacity settled.
+class FlatPairSet {
+public:
+    static constexpr unsigned int NOT_FOUND = ~0u;
+
+    static uint64_t MakeKey(unsigned int a, unsigned int b);
+    static ContactPair GetPair(uint64_t key);
+
+    void Clear();
+    // False if the key was already in the set
+    bool Insert(uint64_t key);
+    bool Contains(uint64_t key) const;
+    // Position of the key in GetKeys, NOT_FOUND if it isn't in the set
+    unsigned int Find(uint64_t key) const;
+    // In insertion order
+    const std::vector<uint64_t>& GetKeys() const;
+
+private:
+    // Both ids would have to be the largest unsigned int
+    static constexpr uint64_t EMPTY_KEY = ~0ull;
+
+    size_t FindSlot(uint64_t key) const;
+    void Grow();
+
+private:
+    std::vector<uint64_t> m_Slots;
+    // Position in m_Keys of the key in each occupied slot
+    std::vector<unsigned int> m_SlotIndices;
+    std::vector<uint64_t> m_Keys;
+    // 64 minus the log2 of the slot count, the top bits of the hash pick the slot
+    unsigned int m_Shift = 64;
+};
+
+// Contacts of the current and the previous frame, sorted into pairs that started
+// touching this frame, kept touching and stopped touching
+class PairCache {
+public:
+    void BeginFrame();
+    // Adding the same pair again in a frame is ignored
+    void Add(unsigned int a, unsigned int b);
+    // Fills the end contacts with the pairs of the previous frame that weren't added
+    void EndFrame();
+
+    const std::vector<ContactPair>& GetBeginContacts() const;
+    const std::vector<ContactPair>& GetPersistContacts() const;
+    const std::vector<ContactPair>& GetEndContacts() const;
+    unsigned int GetContactCount() const;
+
+private:
+    FlatPairSet m_Previous;
+    FlatPairSet m_Current;
+    std::vector<ContactPair> m_BeginContacts;
+    std::vector<ContactPair> m_PersistContacts;
+    std::vector<ContactPair> m_EndContacts;
+};
+
+#endif // !_PAIR_CACHE_H_
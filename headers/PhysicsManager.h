@@ -1,45 +1,203 @@
 #ifndef _PHYSICS_MANAGER_H_
 #define _PHYSICS_MANAGER_H_
 
-#include "Scene.h"
+#include <unordered_map>
 
-#include <set>
+#include "Scene.h"
+#include "EngineSettings.h"
+#include "RigidBodyWorld.h"
+#include "PairCache.h"
+#include "JobSystem.h"
 
+// Keeps a RigidBodyWorld in sync with the scene nodes that are collision bodies. Nodes
+// with a mass are simulated and written back, the others follow their transform.
+// The world advances in fixed steps: the frame time is accumulated and consumed one
+// physics timestep at a time, and the drawn pose is interpolated between the last two
+// steps, so the simulation doesn't depend on the frame rate.
 class PhysicsManager {
 public:
-    void Update(Scene* scene) {
-        collisions.clear();
-        std::vector<std::pair<const std::string, const BoundingSphere>> prevNamedSpheres;
-        DetectCollision(scene->GetSceneRoot(), prevNamedSpheres);
+    // Runs after the scene transforms are up to date. Returns true if simulated bodies were
+    // written to their nodes, whose transforms then need another pass before rendering.
+    bool Update(Scene* scene, JobSystem* jobs, const EngineSettings& settings, float deltaTime) {
+        SyncBodies(scene, jobs, settings);
+
+        bool written = false;
+        m_Contacts.BeginFrame();
+        if (settings.simulateRigidBodies && settings.physicsTimestep > 0.0f) {
+            m_Accumulator += deltaTime;
+            unsigned int steps = 0;
+            while (m_Accumulator >= settings.physicsTimestep && steps < MAX_STEPS_PER_FRAME) {
+                m_World.Step(settings.physicsTimestep, settings, jobs);
+                AddContacts();
+                m_Accumulator -= settings.physicsTimestep;
+                steps++;
+            }
+            // Too far behind to catch up, the simulation slows down instead of spiralling
+            if (m_Accumulator >= settings.physicsTimestep) {
+                m_Accumulator = 0.0f;
+            }
+            if (steps == 0) {
+                AddContacts();
+            }
+            written = WriteBack(m_Accumulator / settings.physicsTimestep) > 0;
+        } else {
+            m_Accumulator = 0.0f;
+            m_World.DetectCollisions(settings, jobs);
+            AddContacts();
+        }
+        m_Contacts.EndFrame();
+        return written;
     }
 
-    void DetectCollision(const SceneNode* currentNode, std::vector<std::pair<const std::string, const BoundingSphere>>& prevNamedSpheres) {
+    // Contact points and normals of the last step, indexed by body
+    const Narrowphase& GetNarrowphase() const {
+        return m_World.GetNarrowphase();
+    }
+
+    // Contact events of the last update, game code reacts to the begin and end lists
+    const PairCache& GetContacts() const {
+        return m_Contacts;
+    }
+
+    // Linear search through this frame's bodies, nullptr for nodes that aren't bodies anymore
+    const SceneNode* FindBody(unsigned int id) const {
+        for (const SceneNode* body : m_Bodies) {
+            if (body->id == id) {
+                return body;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    void GatherBodies(SceneNode* currentNode) {
         const Model* currentModel = currentNode->GetModel();
-        if (currentModel != nullptr && currentNode->name != "ground" && currentNode->name != "wall") {
-            BoundingSphere currentSphere(currentModel->boundingSphere);
-            currentSphere.center = Vector3::Transform(currentSphere.center, currentNode->transform.globalMatrix);
-            currentSphere.radius *= std::max(std::max(currentNode->transform.scale.x, currentNode->transform.scale.y), currentNode->transform.scale.z);
-            for (const auto& prevNamedSphere : prevNamedSpheres) {
-                if (CheckSphereSphereIntersection(currentSphere, prevNamedSphere.second)) {
-                    // Collision resolution
-                    collisions.insert({ currentNode->name, prevNamedSphere.first });
+        if (currentModel != nullptr && currentNode->collisionLayer != 0 && currentNode->collisionMask != 0) {
+            m_Bodies.push_back(currentNode);
+        }
+
+        for (const auto& childNode : currentNode->children) {
+            GatherBodies(childNode.get());
+        }
+    }
+
+    // The world is rebuilt when bodies were added or removed, simulated bodies keep their
+    // pose and velocity. Otherwise only the nodes that aren't simulated are moved, and
+    // every body takes the current world scale of its node.
+    void SyncBodies(Scene* scene, JobSystem* jobs, const EngineSettings& settings) {
+        m_Bodies.clear();
+        GatherBodies(scene->GetSceneRoot());
+
+        bool changed = m_Bodies.size() != m_BodyIds.size();
+        for (size_t i = 0; i < m_Bodies.size() && !changed; i++) {
+            changed = m_Bodies[i]->id != m_BodyIds[i];
+        }
+        if (!changed) {
+            for (unsigned int body = 0; body < m_World.GetBodyCount(); body++) {
+                const Transform& transform = m_Bodies[body]->transform;
+                // Scaled in the editor or through a parent, simulated bodies too
+                m_World.SetScale(body, transform.GetWorldScale());
+                if (m_World.IsStatic(body)) {
+                    m_World.SetPose(body, transform.GetWorldPosition(), transform.GetWorldOrientation());
                 }
             }
+            return;
+        }
 
-            prevNamedSpheres.push_back({currentNode->name, currentSphere});
+        struct State {
+            Vector3 position;
+            Quaternion orientation;
+            Vector3 linearVelocity;
+            Vector3 angularVelocity;
+        };
+        std::unordered_map<unsigned int, State> states;
+        for (unsigned int body = 0; body < m_World.GetBodyCount(); body++) {
+            if (!m_World.IsStatic(body)) {
+                states[m_BodyIds[body]] = { m_World.GetPosition(body), m_World.GetOrientation(body),
+                    m_World.GetLinearVelocity(body), m_World.GetAngularVelocity(body) };
+            }
         }
 
-        for (const auto& childNode : currentNode->children) {
-            DetectCollision(childNode.get(), prevNamedSpheres);
+        m_World.Clear();
+        m_BodyIds.clear();
+        m_WrittenAsleep.clear();
+        for (const SceneNode* node : m_Bodies) {
+            const Model* model = node->GetModel();
+            const bool simulated = node->mass > 0.0f;
+            RigidBodyDesc desc;
+            desc.mass = node->mass;
+            desc.localSphere = model->boundingSphere;
+            const AxisAlignedBox box = AxisAlignedBox::FromBox(model->boundingBox);
+            desc.localExtents = 0.5f * (box.upper - box.lower);
+            desc.hull = &model->collisionHull;
+            desc.mesh = !simulated && node->staticMesh && !model->collisionMesh.IsEmpty() ? &model->collisionMesh : nullptr;
+            desc.scale = node->transform.GetWorldScale();
+            desc.filter = { node->collisionLayer, node->collisionMask };
+
+            const unsigned int body = m_World.AddBody(desc, node->transform.GetWorldPosition(), node->transform.GetWorldOrientation());
+            const auto state = states.find(node->id);
+            if (simulated && state != states.end()) {
+                m_World.SetPose(body, state->second.position, state->second.orientation);
+                m_World.SetVelocity(body, state->second.linearVelocity, state->second.angularVelocity);
+            }
+            m_BodyIds.push_back(node->id);
         }
+        // Contacts of the old body indices are meaningless now
+        m_World.DetectCollisions(settings, jobs);
     }
 
-    bool CheckSphereSphereIntersection(const BoundingSphere& A, const BoundingSphere& B) {
-        return (A.radius + B.radius) * (A.radius + B.radius) > Vector3::DistanceSquared(A.center, B.center);
+    void AddContacts() {
+        for (const Contact& contact : m_World.GetNarrowphase().GetContacts()) {
+            m_Contacts.Add(m_BodyIds[contact.first], m_BodyIds[contact.second]);
+        }
+        // Sleeping islands still touch, they just aren't tested
+        for (const BodyPair& pair : m_World.GetSleepingContacts()) {
+            m_Contacts.Add(m_BodyIds[pair.first], m_BodyIds[pair.second]);
+        }
     }
 
-public:
-    std::set<std::pair<std::string, std::string>> collisions;
+    // Simulated bodies are placed through their parent, alpha is the fraction of a step
+    // the accumulator is ahead of the last one. Sleeping bodies are written once more
+    // after they fell asleep and then left alone, so their transforms stay clean.
+    unsigned int WriteBack(float alpha) {
+        unsigned int written = 0;
+        m_WrittenAsleep.resize(m_World.GetBodyCount(), 0);
+        for (unsigned int body = 0; body < m_World.GetBodyCount(); body++) {
+            const bool sleeping = !m_World.IsStatic(body) && m_World.IsSleeping(body);
+            const bool skip = m_World.IsStatic(body) || (sleeping && m_WrittenAsleep[body]);
+            m_WrittenAsleep[body] = sleeping;
+            if (skip) {
+                continue;
+            }
+            Vector3 position = m_World.GetInterpolatedPosition(body, alpha);
+            Quaternion orientation = m_World.GetInterpolatedOrientation(body, alpha);
+            const SceneNode* parent = m_Bodies[body]->GetParent();
+            if (parent != nullptr) {
+                position = Vector3::Transform(position, parent->transform.globalMatrix.Invert());
+                Quaternion parentInverse = parent->transform.GetWorldOrientation();
+                parentInverse.Conjugate();
+                orientation = orientation * parentInverse;
+            }
+            m_Bodies[body]->transform.SetPosition(position);
+            m_Bodies[body]->transform.SetOrientation(orientation);
+            written++;
+        }
+        return written;
+    }
+
+private:
+    // Steps run in one frame at most, after a long hitch the rest of the time is dropped
+    static constexpr unsigned int MAX_STEPS_PER_FRAME = 8;
+
+    // Kept between frames to reuse their storage
+    std::vector<SceneNode*> m_Bodies;
+    // Node of each body of the world, in body order
+    std::vector<unsigned int> m_BodyIds;
+    RigidBodyWorld m_World;
+    // Sleeping at the last write back
+    std::vector<uint8_t> m_WrittenAsleep;
+    float m_Accumulator = 0.0f;
+    PairCache m_Contacts;
 };
 
-#endif // !_PHYSICS_MANAGER_H_
\ No newline at end of file
+#endif // !_PHYSICS_MANAGER_H_
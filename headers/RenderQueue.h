@@ -0,0 +1,73 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+#include "CullingKernels.h"
+
+class SceneNode;
+class JobSystem;
+
+// Nodes with a model gathered by the culling traversal, in traversal order.
+// Nodes inside a fully visible subtree are accepted directly, the world bounds
+// of the remaining ones are kept as SoA arrays and tested in batches. Culling
+// produces a single list of visible nodes that rendering consumes directly.
+class RenderQueue {
+public:
+    void Clear();
+    void AddVisible(SceneNode* node);
+    void AddCandidate(SceneNode* node, const BoundingSphere& worldBounds);
+
+    // Tests the candidates and builds the visible list. With a job system the queue
+    // is split into chunks, each job collects its visible nodes into its own buffer
+    // and the buffers are merged in chunk order, so the list keeps the traversal order.
+    // With temporal coherence every candidate goes through the per-node CullingState
+    // test instead of the batch kernel. With box culling the candidates whose sphere
+    // passes are tested again with the tighter world box of their model.
+    void Cull(const Frustum& frustum, JobSystem* jobs = nullptr, bool temporalCoherence = false, bool boxCulling = false);
+
+    unsigned int GetCount() const;
+    unsigned int GetCandidateCount() const;
+    // Valid after Cull
+    unsigned int GetVisibleCount() const;
+    SceneNode* GetVisibleNode(unsigned int index) const;
+    unsigned int GetPlaneTestCount() const;
+    // Candidates accepted by the sphere test and rejected by the box test
+    unsigned int GetBoxCulledCount() const;
+
+private:
+    struct ChunkBuffer {
+        std::vector<uint32_t> visibility;
+        std::vector<SceneNode*> visible;
+        unsigned int planeTests = 0;
+        unsigned int boxCulled = 0;
+    };
+
+    void CullRange(const Frustum& frustum, unsigned int begin, unsigned int end, bool temporalCoherence, bool boxCulling, ChunkBuffer& buffer);
+    // Box test of a candidate that passed the sphere test, returns true if still visible
+    static bool TestBox(const Frustum& frustum, const SceneNode* node, ChunkBuffer& buffer);
+
+private:
+    // Queue entries per job, a multiple of 32 keeps the mask words of the jobs apart
+    static constexpr unsigned int PARALLEL_GRAIN_SIZE = 4096;
+
+    std::vector<SceneNode*> m_Nodes;
+    // Number of candidates before each entry, plus the total at the end
+    std::vector<unsigned int> m_CandidateOffsets;
+
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ, m_Radius;
+
+    // Kept between frames to reuse their capacity
+    std::vector<ChunkBuffer> m_Chunks;
+    std::vector<SceneNode*> m_Visible;
+    unsigned int m_PlaneTests = 0;
+    unsigned int m_BoxCulled = 0;
+
+    // Frustum of the previous Cull and the accumulated plane shift, see CullingState
+    std::optional<Frustum> m_PreviousFrustum;
+    double m_TotalShift = 0.0;
+};
+
+#endif // !_RENDER_QUEUE_H_
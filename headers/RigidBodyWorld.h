@@ -0,0 +1,218 @@
+#ifndef _RIGID_BODY_WORLD_H_
+#define _RIGID_BODY_WORLD_H_
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <SimpleMath.h>
+
+#include "EngineSettings.h"
+#include "SweepAndPrune.h"
+#include "SpatialHashGrid.h"
+#include "Narrowphase.h"
+#include "PairCache.h"
+
+using namespace DirectX::SimpleMath;
+
+class JobSystem;
+
+// Mass and collision shape of a body, in model space
+struct RigidBodyDesc {
+    // Zero for static bodies, they only move when placed with SetPose
+    float mass = 0.0f;
+    BoundingSphere localSphere;
+    // Half size of the box the inertia is computed from
+    Vector3 localExtents = Vector3(0.5f);
+    const ConvexHull* hull = nullptr;
+    const TriangleMesh* mesh = nullptr;
+    Vector3 scale = Vector3::One;
+    CollisionFilter filter;
+};
+
+// Rigid bodies in structure of arrays form, advanced in fixed steps: gravity, collision
+// detection, a sequential impulse contact solver and position integration.
+// The narrowphase finds one contact per pair and step, so the points of a pair are
+// kept in a manifold of up to four between steps, topped up from slightly tilted copies
+// of the body, which gives resting bodies a stable support. Each point starts the solver
+// from the impulses it ended the last step with (warm starting), so stacks settle in a
+// few iterations instead of sinking.
+// Dynamic bodies joined by manifolds form islands, found with union-find every step.
+// Islands share no dynamic body, so they are solved in parallel. An island whose bodies
+// all stayed slow for a while falls asleep: it keeps its manifolds, and its pairs are
+// only tested again once an awake or moved body touches it, which wakes the island.
+class RigidBodyWorld {
+public:
+    unsigned int AddBody(const RigidBodyDesc& desc, const Vector3& position, const Quaternion& orientation);
+    void Clear();
+    // Places a body without giving it a velocity, for static bodies moved from outside.
+    // Wakes a dynamic body, a static one wakes what it touches if the pose changed.
+    void SetPose(unsigned int body, const Vector3& position, const Quaternion& orientation);
+    // Rescales the shape and the inertia, wakes the body like SetPose. Changes within
+    // rounding of the world matrix are ignored, so calling it every frame is cheap.
+    void SetScale(unsigned int body, const Vector3& scale);
+    void SetVelocity(unsigned int body, const Vector3& linearVelocity, const Vector3& angularVelocity);
+    // Wakes the island of a sleeping body
+    void WakeBody(unsigned int body);
+
+    // Collision detection only, the contacts of the current poses
+    void DetectCollisions(const EngineSettings& settings, JobSystem* jobs = nullptr);
+    void Step(float timestep, const EngineSettings& settings, JobSystem* jobs = nullptr);
+
+    unsigned int GetBodyCount() const;
+    bool IsStatic(unsigned int body) const;
+    bool IsSleeping(unsigned int body) const;
+    const Vector3& GetPosition(unsigned int body) const;
+    const Quaternion& GetOrientation(unsigned int body) const;
+    const Vector3& GetLinearVelocity(unsigned int body) const;
+    const Vector3& GetAngularVelocity(unsigned int body) const;
+    // Pose between the last two steps, alpha 0 gives the earlier one
+    Vector3 GetInterpolatedPosition(unsigned int body, float alpha) const;
+    Quaternion GetInterpolatedOrientation(unsigned int body, float alpha) const;
+
+    // Contacts of the last detection, indexed by body
+    const Narrowphase& GetNarrowphase() const;
+    // Pairs of sleeping islands that still touch, they aren't tested by the narrowphase
+    const std::vector<BodyPair>& GetSleepingContacts() const;
+    unsigned int GetManifoldPointCount() const;
+    // Of the last step, sleeping islands aren't counted
+    unsigned int GetIslandCount() const;
+    unsigned int GetAwakeBodyCount() const;
+
+public:
+    Vector3 gravity = Vector3(0.0f, -9.81f, 0.0f);
+    float friction = 0.5f;
+
+private:
+    static constexpr unsigned int MAX_MANIFOLD_POINTS = 4;
+    static constexpr unsigned int NO_ISLAND = ~0u;
+
+    struct ManifoldPoint {
+        // Deepest point of each body in its own frame, without scale
+        Vector3 localA;
+        Vector3 localB;
+        float depth;
+        float normalImpulse;
+        float tangentImpulses[2];
+    };
+
+    struct Manifold {
+        unsigned int bodyA;
+        unsigned int bodyB;
+        // From a towards b
+        Vector3 normal;
+        unsigned int pointCount;
+        ManifoldPoint points[MAX_MANIFOLD_POINTS];
+    };
+
+    struct ContactConstraint {
+        unsigned int bodyA;
+        unsigned int bodyB;
+        Vector3 normal;
+        Vector3 tangents[2];
+        // From the body positions to the contact point
+        Vector3 offsetA;
+        Vector3 offsetB;
+        float normalMass;
+        float tangentMasses[2];
+        // Separating velocity that removes the penetration beyond the slop over a few steps
+        float bias;
+        float normalImpulse;
+        float tangentImpulses[2];
+    };
+
+    // Awake bodies of an island are a run of m_IslandBodies, its manifolds a run of
+    // m_IslandManifolds and its contact points a run of m_Constraints
+    struct Island {
+        unsigned int bodyBegin;
+        unsigned int bodyCount;
+        unsigned int manifoldBegin;
+        unsigned int manifoldCount;
+        unsigned int constraintBegin;
+        unsigned int constraintCount;
+        // Every body stayed below the sleep velocities long enough
+        bool resting;
+    };
+
+    void UpdateCollisionBodies();
+    // Without skipResting every candidate pair is tested, otherwise pairs without an
+    // awake or moved body keep their manifold from the last step
+    void FindContacts(const EngineSettings& settings, JobSystem* jobs, bool skipResting);
+    // Top ups of the manifolds run on the workers when given a job system
+    void UpdateManifolds(JobSystem* jobs);
+    void AddManifoldPoint(Manifold& manifold, const ManifoldPoint& point) const;
+    void AddPerturbedPoints(Manifold& manifold) const;
+    void BuildIslands();
+    unsigned int FindRoot(unsigned int body);
+    void SolveIsland(Island& island, float timestep, const EngineSettings& settings);
+    void PrepareConstraints(const Island& island, float timestep, bool warmStarting);
+    void SolveConstraints(const Island& island);
+    void StoreImpulses(const Island& island);
+    void IntegratePositions(const Island& island, float timestep);
+    void SleepIslands();
+    void WakeAll();
+
+    void ApplyImpulse(unsigned int bodyA, unsigned int bodyB, const Vector3& offsetA, const Vector3& offsetB, const Vector3& impulse);
+    float GetEffectiveMass(unsigned int bodyA, unsigned int bodyB, const Vector3& offsetA, const Vector3& offsetB, const Vector3& direction) const;
+
+private:
+    // Pose and velocity
+    std::vector<Vector3> m_Positions;
+    std::vector<Quaternion> m_Orientations;
+    std::vector<Vector3> m_PreviousPositions;
+    std::vector<Quaternion> m_PreviousOrientations;
+    std::vector<Vector3> m_LinearVelocities;
+    std::vector<Vector3> m_AngularVelocities;
+    // Zero for static bodies, the inertia is a diagonal in the body frame
+    std::vector<float> m_InverseMasses;
+    std::vector<Vector3> m_InverseInertias;
+    std::vector<Matrix> m_WorldInverseInertias;
+    // Unscaled, the inertia is recomputed from them when the scale changes
+    std::vector<Vector3> m_LocalExtents;
+
+    // Shape
+    std::vector<BoundingSphere> m_LocalSpheres;
+    std::vector<Vector3> m_Scales;
+    std::vector<const ConvexHull*> m_Hulls;
+    std::vector<const TriangleMesh*> m_Meshes;
+    std::vector<CollisionFilter> m_Filters;
+
+    // Sleep state, the sleeping island of a body or NO_ISLAND
+    std::vector<unsigned int> m_SleepingIslandIds;
+    std::vector<float> m_SleepTimes;
+    // Static bodies placed somewhere else since the last step
+    std::vector<uint8_t> m_Moved;
+    // Awake dynamic or moved static, only these bring their pairs to the narrowphase
+    std::vector<uint8_t> m_Active;
+    std::unordered_map<unsigned int, std::vector<unsigned int>> m_SleepingIslands;
+    unsigned int m_NextSleepingIslandId = 0;
+
+    // Collision detection, rebuilt every step
+    std::vector<CollisionBody> m_CollisionBodies;
+    std::vector<AxisAlignedBox> m_Bounds;
+    std::vector<BodyPair> m_Pairs;
+    std::vector<BodyPair> m_TestedPairs;
+    SweepAndPrune m_SweepAndPrune;
+    SpatialHashGrid m_SpatialHashGrid;
+    Narrowphase m_Narrowphase;
+
+    // Manifolds of the pairs touching in the last step, found by pair key
+    std::vector<Manifold> m_Manifolds;
+    std::vector<Manifold> m_PreviousManifolds;
+    // Pair keys inserted in manifold order, so a key's position is its manifold index
+    FlatPairSet m_ManifoldKeys;
+    FlatPairSet m_PreviousManifoldKeys;
+    // Manifolds of this step with room for perturbed points
+    std::vector<unsigned int> m_TopUpManifolds;
+    std::vector<BodyPair> m_SleepingContacts;
+
+    // Islands of the last step, rebuilt every step
+    std::vector<unsigned int> m_IslandParents;
+    std::vector<unsigned int> m_IslandIndices;
+    std::vector<Island> m_Islands;
+    std::vector<unsigned int> m_IslandBodies;
+    std::vector<unsigned int> m_IslandManifolds;
+    std::vector<ContactConstraint> m_Constraints;
+};
+
+#endif // !_RIGID_BODY_WORLD_H_
@@ -9,11 +9,18 @@
 
 #include "Camera.h"
 #include "Light.h"
+#include "FrameStatistics.h"
+#include "EngineSettings.h"
+#include "TransformHierarchy.h"
+#include "RenderQueue.h"
+#include "OcclusionCulling.h"
+#include "DynamicAabbTree.h"
 
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
 
 class ScriptingManager;
+class JobSystem;
 
 class Scene {
 public:
@@ -21,13 +28,19 @@ public:
     bool Initialize(int, int, HWND);
     void Shutdown();
 
-    void Update(float, ScriptingManager*);
-    bool Render();
+    void Update(float, ScriptingManager*, JobSystem*, const EngineSettings&);
+    // Recomputes the dirty world matrices and moves their nodes in the spatial tree,
+    // for nodes written after Update such as simulated bodies
+    void UpdateTransforms(JobSystem*, const EngineSettings&);
+    bool Render(JobSystem* jobs, const EngineSettings& settings);
     
     void HandleResize(int, int);
     
     Camera* GetMainCamera();
-    const SceneNode* GetSceneRoot();
+    SceneNode* GetSceneRoot();
+    const FrameStatistics& GetStatistics() const;
+    // Every node with a model, kept in sync with the transforms by Update
+    const DynamicAabbTree& GetSpatialTree() const;
 
 private:
     bool InitializeShaders();
@@ -35,6 +48,11 @@ private:
     void InitializeMaterials();
     bool InitializeModels();
     void InitializeScene(int, int);
+    // Inserts the nodes with a model of the subtree into the spatial tree
+    void InsertIntoSpatialTree(SceneNode*);
+    void UpdateSpatialTree(const std::vector<SceneNode*>& movedNodes);
+    // Draws the frustum visible occluders into the occlusion buffer and builds its pyramid
+    void RasterizeOccluders();
 
 public:
     std::string name;
@@ -46,6 +64,11 @@ private:
     std::map<std::string, std::unique_ptr<Texture>> m_Textures;
     std::map<std::string, std::unique_ptr<Material>> m_Materials;
     std::unique_ptr<SceneNode> m_SceneRoot;
+    TransformHierarchy m_TransformHierarchy;
+    RenderQueue m_RenderQueue;
+    OcclusionBuffer m_OcclusionBuffer;
+    DynamicAabbTree m_SpatialTree;
+    std::vector<SceneNode*> m_MovedNodes;
 
     std::map<std::string, std::unique_ptr<Shader>> m_Shaders;
     ShaderPayload m_ShaderPayload;
@@ -56,6 +79,8 @@ private:
 
     int m_ScreenWidth, m_ScreenHeight;
 
+    FrameStatistics m_Stats;
+
     friend class Serializer;
     friend class Deserializer;
 };
@@ -3,41 +3,88 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 #include <SimpleMath.h>
 
 #include "Model.hpp"
+#include "DynamicAabbTree.h"
 
 using namespace DirectX::SimpleMath;
 
 struct Frustum;
+struct FrameStatistics;
+class RenderQueue;
 class ScriptingManager;
 
 class SceneNode {
 public:
     SceneNode(std::string _name, const SceneNode* parent = nullptr, const Model* model = nullptr);
     //virtual ~SceneNode() = default;
-    bool Render(ID3D11DeviceContext*, ShaderPayload*, Frustum* = nullptr);
-    void UpdateTransform();
+    // Appends the nodes with a model to the queue. Subtrees are rejected or fully
+    // accepted by their subtree bound, the rest is left for the batch frustum test.
+    void GatherRenderables(const Frustum& camFrustum, RenderQueue& queue, FrameStatistics* stats = nullptr, bool insideFrustum = false);
+    // Recomputes global matrices for dirty nodes and their descendants,
+    // returns the number of recomputed matrices. Subtree bounds are refit on the way up.
+    // Nodes with a model whose bounds changed are appended to movedNodes.
+    unsigned int UpdateTransform(bool parentChanged = false, std::vector<SceneNode*>* movedNodes = nullptr);
     void Update(float deltaTime, ScriptingManager* scripting);
     void AddChild(std::unique_ptr<SceneNode>&& child);
 
     void SetModel(const Model*);
     const Model* GetModel() const;
+    const SceneNode* GetParent() const;
+    // World space bound of the model, refreshed together with the global matrix
+    void UpdateWorldBounds();
+    const BoundingSphere& GetWorldBounds() const;
+    const OrientedBox& GetWorldBox() const;
+    // Rebuilds the bound enclosing the models of the whole subtree from the
+    // children's subtree bounds, returns false if it was already up to date
+    bool RefitSubtreeBounds();
+    void MarkSubtreeBoundsDirty();
+    // False if there is no model in the subtree
+    bool HasSubtreeBounds() const;
+    const BoundingSphere& GetSubtreeBounds() const;
 
     virtual std::string GetType();
 
 public:
+    // Unique among the nodes created during the run, assigned at construction
+    const unsigned int id;
     std::string name;
     Transform transform;
     std::vector<std::unique_ptr<SceneNode>> children;
     bool culled = false;
+    // The whole subtree was rejected without visiting the descendants
+    bool subtreeCulled = false;
+    // Frame to frame state of the frustum test, reset when the node moves
+    CullingState cullingState;
     bool moving = false;
+    // Rasterized into the occlusion buffer instead of being tested against it
+    bool occluder = false;
+    // Bits of the collision layers the node is in and the layers it collides with,
+    // nodes with no layer or an empty mask aren't collision bodies
+    uint32_t collisionLayer = 1;
+    uint32_t collisionMask = ~0u;
+    // Collides with the triangles of its model instead of the hull, for ground and
+    // walls that never move
+    bool staticMesh = false;
+    // Simulated as a rigid body when positive, the physics then owns the transform
+    float mass = 0.0f;
+    // Leaf of the scene's DynamicAabbTree, only nodes with a model have one
+    int spatialProxy = DynamicAabbTree::NULL_PROXY;
+    // Level of detail drawn last frame, the hysteresis of the next selection starts from it
+    unsigned int lod = 0;
 
 private:
     // Observing pointers
     const SceneNode* m_Parent;
     const Model* m_Model;
+    BoundingSphere m_WorldBounds;
+    OrientedBox m_WorldBox;
+    BoundingSphere m_SubtreeBounds;
+    bool m_HasSubtreeBounds = false;
+    bool m_SubtreeBoundsDirty = true;
     
     float dir = -1.0f;
 
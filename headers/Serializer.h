@@ -8,6 +8,7 @@
 
 #include "Scene.h"
 #include "Shader.h"
+#include "Broadphase.h"
 
 namespace DirectX {
     namespace SimpleMath {
@@ -116,6 +117,12 @@ inline nlohmann::ordered_json Serializer::SerializeModel(std::string name, Model
     j["name"] = name;
     j["path"] = model->m_Path;
     j["material"] = model->m_Material->name;
+    for (size_t i = 1; i < model->m_Lods.size(); i++) {
+        json jLod;
+        jLod["path"] = model->m_Lods[i].path;
+        jLod["screen_size"] = model->m_Lods[i].screenSize;
+        j["lods"].push_back(jLod);
+    }
 
     return j;
 }
@@ -126,6 +133,16 @@ nlohmann::ordered_json Serializer::SerializeSceneNode(SceneNode* node) {
     std::string type = node->GetType();
     j["type"] = type;
     j["transform"] = node->transform;
+    if (node->occluder)
+        j["occluder"] = true;
+    if (node->collisionLayer != CollisionFilter::DEFAULT_LAYER)
+        j["collision_layer"] = node->collisionLayer;
+    if (node->collisionMask != CollisionFilter::ALL_LAYERS)
+        j["collision_mask"] = node->collisionMask;
+    if (node->staticMesh)
+        j["static_mesh"] = true;
+    if (node->mass > 0.0f)
+        j["mass"] = node->mass;
     /*if (node->m_Parent)
         j["parent"] = node->m_Parent->name;
     else
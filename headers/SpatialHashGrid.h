@@ -0,0 +1,56 @@
+#ifndef _SPATIAL_HASH_GRID_H_
+#define _SPATIAL_HASH_GRID_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "Broadphase.h"
+
+// Uniform grid broadphase for many bodies of similar size. Every body is entered in
+// the cells its box overlaps, the cells are hashed into a table rebuilt each frame
+// with a counting sort, so the bodies of a bucket are contiguous in one array. Only
+// bodies sharing a cell are compared, and a pair is reported by the cell holding the
+// lower corner of the overlap of the two boxes, so it comes out once however many
+// cells they share. Works best with cells about as large as the biggest body, bodies
+// spanning more than a few cells per axis (ground planes) stay out of the grid and
+// are tested against every other body instead.
+class SpatialHashGrid : public Broadphase {
+public:
+    SpatialHashGrid(float cellSize = 2.0f);
+
+    void FindPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+        std::vector<BodyPair>& pairs) override;
+
+    void SetCellSize(float cellSize);
+    float GetCellSize() const;
+    // Body and cell entries of the last call
+    unsigned int GetEntryCount() const;
+    unsigned int GetBucketCount() const;
+
+private:
+    struct Entry {
+        int x, y, z;
+        unsigned int body;
+    };
+
+    void FindOversizedPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+        std::vector<BodyPair>& pairs) const;
+    int ToCell(float coordinate) const;
+    static uint32_t Hash(int x, int y, int z);
+
+private:
+    static constexpr int MAX_CELLS_PER_AXIS = 8;
+
+    float m_CellSize;
+    float m_InverseCellSize;
+    // Entries in body order, then sorted by bucket
+    std::vector<Entry> m_Entries;
+    std::vector<Entry> m_SortedEntries;
+    std::vector<uint32_t> m_EntryBuckets;
+    // Start of each bucket in m_SortedEntries, with one past the end at the back
+    std::vector<unsigned int> m_BucketStarts;
+    // Bodies left out of the grid, in body order
+    std::vector<unsigned int> m_OversizedBodies;
+};
+
+#endif // !_SPATIAL_HASH_GRID_H_
@@ -0,0 +1,41 @@
+#ifndef _SWEEP_AND_PRUNE_H_
+#define _SWEEP_AND_PRUNE_H_
+
+#include <vector>
+
+#include "Broadphase.h"
+
+// Sweep and prune broadphase over world space boxes. The boxes are sorted by their
+// lower bound on the axis along which the box centers vary the most, and each box
+// is only compared with the following ones that start before it ends on that axis.
+// The order is kept between frames and repaired with an insertion sort, which is
+// close to linear while bodies move a little per frame.
+class SweepAndPrune : public Broadphase {
+public:
+    void FindPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+        std::vector<BodyPair>& pairs) override;
+
+    // Sort axis of the last call, 0 to 2 for x to z
+    unsigned int GetAxis() const;
+    // Entries moved by the insertion sort in the last call, 0 if it sorted from scratch
+    unsigned int GetSwapCount() const;
+
+private:
+    struct Entry {
+        AxisAlignedBox box;
+        CollisionFilter filter;
+        unsigned int body;
+    };
+
+    unsigned int ChooseAxis(const std::vector<AxisAlignedBox>& bounds) const;
+    // Sorts from scratch when the body count or the axis changed
+    void SortEntries(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters, unsigned int axis);
+
+private:
+    // Sorted by box.lower on m_Axis
+    std::vector<Entry> m_Entries;
+    unsigned int m_Axis = 0;
+    unsigned int m_SwapCount = 0;
+};
+
+#endif // !_SWEEP_AND_PRUNE_H_
@@ -4,6 +4,8 @@
 #include <SimpleMath.h>
 using namespace DirectX::SimpleMath;
 
+class TransformHierarchy;
+
 class Transform {
 public:
     Transform(
@@ -24,16 +26,72 @@ public:
         Matrix localMatrix
     );
 
+    // Copies never share the hierarchy slot of the source, assigning into
+    // a bound transform keeps its slot and pushes the new values into it
+    Transform(const Transform&);
+    Transform& operator=(const Transform&);
+
+    static Matrix ComposeLocalMatrix(const Vector3& position, const Vector3& rotation, const Vector3& scale);
+    // Lengths of the rows of the 3x3 part, the scale each model axis ends up with
+    static Vector3 GetAxisLengths(const Matrix& matrix);
+
     Matrix GetLocalMatrix();
-    void UpdateGlobalMatrix(const Matrix&);
+    // Also propagates the cached world orientation and scale
+    void UpdateGlobalMatrix(const Transform& parent);
+    // For transforms without a parent
+    void UpdateGlobalMatrix();
+
+    void SetPosition(const Vector3&);
+    void SetRotation(const Vector3&);
+    void SetOrientation(const Quaternion&);
+    void SetScale(const Vector3&);
+
+    // Local rotation as a quaternion, kept in sync with the Euler angles
+    const Quaternion& GetOrientation() const;
+    // World space values cached with globalMatrix, so consumers never decompose it.
+    // The world scale holds the lengths of the globalMatrix rows, which stay right
+    // for children rotated under a non-uniformly scaled parent
+    Vector3 GetWorldPosition() const;
+    const Quaternion& GetWorldOrientation() const;
+    const Vector3& GetWorldScale() const;
+    float GetMaxWorldScale() const;
+
+    // Must be called after writing position, rotation or scale directly
+    void MarkDirty();
+    // The local matrix is still valid, but the parent moved or changed
+    void MarkGlobalDirty();
+    bool IsDirty() const;
+
+    bool IsInHierarchy() const;
+    unsigned int GetHierarchyIndex() const;
 
 public:
-    // Position, Rotation and Scale refer to local coordinates
+    // Position, Rotation and Scale refer to local coordinates,
+    // rotation holds Euler angles in radians (pitch, yaw, roll)
     Vector3 position;
     Vector3 rotation;
     Vector3 scale;
 
     Matrix globalMatrix;
+
+private:
+    void UpdateGlobalMatrix(const Matrix& parentGlobalMatrix, const Quaternion& parentOrientation);
+    void Invalidate();
+
+private:
+    Quaternion m_Orientation;
+    Quaternion m_WorldOrientation;
+    Vector3 m_WorldScale = Vector3::One;
+
+    Matrix m_LocalMatrix;
+    bool m_LocalDirty = true;
+    bool m_GlobalDirty = true;
+
+    // Slot in the flattened hierarchy, if the owning node was flattened
+    TransformHierarchy* m_Hierarchy = nullptr;
+    unsigned int m_HierarchyIndex = 0;
+
+    friend class TransformHierarchy;
 };
 
-#endif // !_TRANSFORM_H_
\ No newline at end of file
+#endif // !_TRANSFORM_H_
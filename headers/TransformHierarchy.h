@@ -0,0 +1,80 @@
+#ifndef _TRANSFORM_HIERARCHY_H_
+#define _TRANSFORM_HIERARCHY_H_
+
+#include <vector>
+#include <cstdint>
+
+#include <SimpleMath.h>
+
+#include "TransformKernels.h"
+
+using namespace DirectX::SimpleMath;
+
+class SceneNode;
+class JobSystem;
+
+// Flattened scene hierarchy: local transforms, parent indices and global matrices
+// are kept in contiguous arrays sorted by depth, so every parent is stored before
+// its children and the global matrices can be propagated in a single linear pass.
+// Bound nodes keep their Transform as the authoring interface, edits are forwarded
+// here and the resulting global matrices are copied back after each update.
+class TransformHierarchy {
+public:
+    static constexpr unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
+    // Flattens the subtree of root breadth-first and binds every node to its slot.
+    // Must be called again after the structure of the scene graph changes.
+    void Build(SceneNode* root);
+    void Clear();
+    // Returns the number of recomputed global matrices. With a job system each depth
+    // level is split across the workers, nodes of one level only read the previous
+    // level, so the results are identical to the serial pass.
+    unsigned int Update(JobSystem* jobs = nullptr);
+
+    void SetLocal(unsigned int index, const Vector3& position, const Vector3& rotation, const Quaternion& orientation, const Vector3& scale);
+    void MarkGlobalDirty(unsigned int index);
+
+    unsigned int GetCount() const;
+    unsigned int GetDepthCount() const;
+    unsigned int GetParent(unsigned int index) const;
+    const Matrix& GetGlobalMatrix(unsigned int index) const;
+    SceneNode* GetNode(unsigned int index) const;
+    // Nodes with a model whose world bounds changed in the last Update
+    const std::vector<SceneNode*>& GetMovedNodes() const;
+
+private:
+    LocalTransformArrays GetLocalArrays() const;
+    unsigned int UpdateRange(unsigned int begin, unsigned int end);
+    void WriteBackRange(unsigned int begin, unsigned int end);
+    // Refits the subtree bounds of the nodes whose world bounds changed and their ancestors,
+    // clears the global dirty flags and collects the moved nodes
+    void RefitBounds();
+
+private:
+    // Levels smaller than this are not worth distributing
+    static constexpr unsigned int PARALLEL_GRAIN_SIZE = 1024;
+    // Dirty local transforms are collected and composed by the SIMD kernel in batches
+    static constexpr unsigned int LOCAL_BATCH_SIZE = 64;
+
+    // Local components split per axis, as consumed by TransformKernels
+    std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+    std::vector<float> m_RotationX, m_RotationY, m_RotationZ;
+    std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+    std::vector<Quaternion> m_Orientations;
+    std::vector<unsigned int> m_Parents;
+    std::vector<Matrix> m_LocalMatrices;
+    std::vector<Matrix> m_GlobalMatrices;
+    std::vector<Quaternion> m_WorldOrientations;
+    std::vector<Vector3> m_WorldScales;
+    std::vector<uint8_t> m_LocalDirty;
+    std::vector<uint8_t> m_GlobalDirty;
+    // First index of each depth level, plus one past the last node
+    std::vector<unsigned int> m_DepthOffsets;
+
+    // Observing pointers, used to write the global matrices back
+    std::vector<SceneNode*> m_Nodes;
+    std::vector<SceneNode*> m_MovedNodes;
+    bool m_AnyDirty = false;
+};
+
+#endif // !_TRANSFORM_HIERARCHY_H_
@@ -0,0 +1,49 @@
+#ifndef _TRANSFORM_KERNELS_H_
+#define _TRANSFORM_KERNELS_H_
+
+#include <SimpleMath.h>
+
+using namespace DirectX::SimpleMath;
+
+// x64 always has SSE2, AVX is only used when the compiler targets it (/arch:AVX)
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define TRANSFORM_KERNELS_SSE
+#endif
+#if defined(__AVX__)
+#define TRANSFORM_KERNELS_AVX
+#endif
+
+// Local transform components stored as separate float arrays (structure of arrays)
+struct LocalTransformArrays {
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+    const float* rotationX;
+    const float* rotationY;
+    const float* rotationZ;
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+};
+
+// Batched versions of Transform::ComposeLocalMatrix (scale * yaw-pitch-roll * translation).
+// The matrix of element i is written to out[i].
+namespace TransformKernels {
+    // Composes the elements [begin, end)
+    void ComposeLocalMatrices(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out);
+    // Composes the elements listed in indices
+    void ComposeLocalMatrices(const LocalTransformArrays& arrays, const unsigned int* indices, unsigned int count, Matrix* out);
+
+    void ComposeLocalMatricesScalar(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out);
+#ifdef TRANSFORM_KERNELS_SSE
+    void ComposeLocalMatricesSSE(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out);
+#endif
+#ifdef TRANSFORM_KERNELS_AVX
+    void ComposeLocalMatricesAVX(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out);
+#endif
+
+    // Name of the widest instruction set ComposeLocalMatrices dispatches to
+    const char* GetInstructionSetName();
+}
+
+#endif // !_TRANSFORM_KERNELS_H_
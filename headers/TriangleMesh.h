@@ -0,0 +1,100 @@
+#ifndef _TRIANGLE_MESH_H_
+#define _TRIANGLE_MESH_H_
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+#include "FrustumCulling.h"
+
+// Static triangle soup with a bounding volume hierarchy, the collider of ground and
+// walls. The tree is built once with the binned surface area heuristic and stored
+// depth first in 32 byte nodes: the first child of an inner node follows it, so only
+// the second child's index is kept. Triangles are copied into leaf order, a leaf
+// reads one contiguous run of them.
+class TriangleMesh {
+public:
+    struct Triangle {
+        Vector3 a, b, c;
+    };
+
+    // indices holds three vertex indices per triangle
+    void Build(const std::vector<Vector3>& vertices, const std::vector<unsigned int>& indices);
+
+    bool IsEmpty() const;
+    unsigned int GetTriangleCount() const;
+    unsigned int GetNodeCount() const;
+    const AxisAlignedBox& GetBounds() const;
+
+    // callback(const Triangle&) for the triangles whose box overlaps the query box,
+    // returns the number of visited nodes
+    template<typename F>
+    unsigned int QueryBox(const AxisAlignedBox& box, F&& callback) const;
+
+private:
+    struct Node {
+        Vector3 lower;
+        // First triangle of a leaf, second child of an inner node
+        uint32_t offset;
+        Vector3 upper;
+        // Zero for inner nodes
+        uint32_t triangleCount;
+    };
+
+    struct BuildTriangle {
+        AxisAlignedBox bounds;
+        Vector3 centroid;
+        unsigned int index;
+    };
+
+    void BuildNode(std::vector<BuildTriangle>& triangles, unsigned int begin, unsigned int end, int depth,
+        const std::vector<Vector3>& vertices, const std::vector<unsigned int>& indices);
+
+private:
+    static constexpr unsigned int MAX_LEAF_TRIANGLES = 4;
+    static constexpr unsigned int BIN_COUNT = 12;
+    // Queries keep at most one node per level on the stack, the build makes leaves
+    // of whatever is left at this depth
+    static constexpr int STACK_SIZE = 64;
+
+    std::vector<Node> m_Nodes;
+    std::vector<Triangle> m_Triangles;
+    AxisAlignedBox m_Bounds;
+};
+
+template<typename F>
+unsigned int TriangleMesh::QueryBox(const AxisAlignedBox& box, F&& callback) const {
+    unsigned int visited = 0;
+    if (m_Nodes.empty()) {
+        return visited;
+    }
+
+    uint32_t stack[STACK_SIZE];
+    int stackSize = 0;
+    uint32_t index = 0;
+    while (true) {
+        const Node& node = m_Nodes[index];
+        visited++;
+        const bool overlaps = node.lower.x <= box.upper.x && box.lower.x <= node.upper.x
+            && node.lower.y <= box.upper.y && box.lower.y <= node.upper.y
+            && node.lower.z <= box.upper.z && box.lower.z <= node.upper.z;
+        if (overlaps && node.triangleCount == 0) {
+            assert(stackSize < STACK_SIZE);
+            stack[stackSize++] = node.offset;
+            index++;
+            continue;
+        }
+        if (overlaps) {
+            for (uint32_t i = node.offset; i < node.offset + node.triangleCount; i++) {
+                callback(m_Triangles[i]);
+            }
+        }
+        if (stackSize == 0) {
+            break;
+        }
+        index = stack[--stackSize];
+    }
+    return visited;
+}
+
+#endif // !_TRIANGLE_MESH_H_
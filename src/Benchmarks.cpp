@@ -0,0 +1,1153 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "JobSystem.h"
+#include "Transform.h"
+#include "TransformHierarchy.h"
+#include "TransformKernels.h"
+#include "SceneNode.h"
+#include "Camera.h"
+#include "CullingKernels.h"
+#include "RenderQueue.h"
+#include "OcclusionCulling.h"
+#include "DynamicAabbTree.h"
+#include "SweepAndPrune.h"
+#include "SpatialHashGrid.h"
+#include "Narrowphase.h"
+#include "ConvexHull.h"
+#include "TriangleMesh.h"
+#include "RigidBodyWorld.h"
+
+namespace {
+    const int BENCHMARK_REPETITIONS = 5;
+    // Levels of the long branches hierarchy, shallow enough for the recursive walk
+    const unsigned int BRANCH_LENGTH = 1000;
+
+    // Best time out of a few runs, to filter out scheduling noise
+    template<typename F>
+    double MeasureMilliseconds(F&& function, int repetitions = BENCHMARK_REPETITIONS) {
+        double best = 1e30;
+        for (int i = 0; i < repetitions; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            function();
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+
+    double MaxMatrixError(const std::vector<Matrix>& reference, const std::vector<Matrix>& matrices) {
+        double maxError = 0.0;
+        for (size_t i = 0; i < reference.size(); i++) {
+            for (int row = 0; row < 4; row++) {
+                for (int column = 0; column < 4; column++) {
+                    maxError = std::max(maxError, static_cast<double>(std::fabs(reference[i].m[row][column] - matrices[i].m[row][column])));
+                }
+            }
+        }
+        return maxError;
+    }
+
+    unsigned int CountMismatches(const std::vector<uint32_t>& reference, const std::vector<uint32_t>& visibility, unsigned int count) {
+        unsigned int mismatches = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            if (CullingKernels::IsVisible(reference.data(), i) != CullingKernels::IsVisible(visibility.data(), i)) {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+
+    Vector3 RandomVector(std::mt19937& rng, float minValue, float maxValue) {
+        std::uniform_real_distribution<float> distribution(minValue, maxValue);
+        return Vector3(distribution(rng), distribution(rng), distribution(rng));
+    }
+
+    // Axis aligned rectangle corner + [0, 1] * edgeU + [0, 1] * edgeV, used as an occluder
+    struct Quad {
+        Vector3 corner;
+        Vector3 edgeU;
+        Vector3 edgeV;
+    };
+
+    // True if the segment from the origin to the point passes through the quad
+    bool IsBlocked(const Quad& quad, const Vector3& point) {
+        const Vector3 normal = quad.edgeU.Cross(quad.edgeV);
+        const float denominator = normal.Dot(point);
+        if (denominator == 0.0f) {
+            return false;
+        }
+        const float t = normal.Dot(quad.corner) / denominator;
+        if (t <= 0.0f || t >= 1.0f) {
+            return false;
+        }
+        const Vector3 offset = point * t - quad.corner;
+        const float u = offset.Dot(quad.edgeU) / quad.edgeU.LengthSquared();
+        const float v = offset.Dot(quad.edgeV) / quad.edgeV.LengthSquared();
+        return u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f;
+    }
+
+    // Reference visibility from the origin, samples a grid on every face of the box
+    bool IsVisibleFromOrigin(const OrientedBox& box, const std::vector<Quad>& occluders) {
+        const int GRID = 8;
+        for (int axis = 0; axis < 3; axis++) {
+            const Vector3& normal = box.halfAxes[axis];
+            const Vector3& u = box.halfAxes[(axis + 1) % 3];
+            const Vector3& v = box.halfAxes[(axis + 2) % 3];
+            for (float side = -1.0f; side <= 1.0f; side += 2.0f) {
+                for (int i = 0; i <= GRID; i++) {
+                    for (int j = 0; j <= GRID; j++) {
+                        const Vector3 point = box.center + normal * side
+                            + u * (2.0f * i / GRID - 1.0f) + v * (2.0f * j / GRID - 1.0f);
+                        bool blocked = false;
+                        for (const Quad& quad : occluders) {
+                            blocked = blocked || IsBlocked(quad, point);
+                        }
+                        if (!blocked) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool IsColliding(const BoundingSphere& a, const BoundingSphere& b) {
+        return (a.radius + b.radius) * (a.radius + b.radius) > Vector3::DistanceSquared(a.center, b.center);
+    }
+
+    std::vector<AxisAlignedBox> ToBounds(const std::vector<BoundingSphere>& spheres) {
+        std::vector<AxisAlignedBox> bounds(spheres.size());
+        for (size_t i = 0; i < spheres.size(); i++) {
+            bounds[i] = AxisAlignedBox::FromSphere(spheres[i]);
+        }
+        return bounds;
+    }
+
+    // Reference for the broadphases, the loop PhysicsManager used to run
+    unsigned int CountCollisionsAllPairs(const std::vector<BoundingSphere>& spheres) {
+        unsigned int collisions = 0;
+        for (size_t i = 0; i < spheres.size(); i++) {
+            for (size_t j = 0; j < i; j++) {
+                collisions += IsColliding(spheres[i], spheres[j]);
+            }
+        }
+        return collisions;
+    }
+
+    unsigned int CountCollisions(const std::vector<BodyPair>& pairs, const std::vector<BoundingSphere>& spheres) {
+        unsigned int collisions = 0;
+        for (const BodyPair& pair : pairs) {
+            collisions += IsColliding(spheres[pair.first], spheres[pair.second]);
+        }
+        return collisions;
+    }
+
+    unsigned int Difference(unsigned int a, unsigned int b) {
+        return a > b ? a - b : b - a;
+    }
+
+    // Fills the tree breadth-first, every node gets branching children until nodeCount is reached
+    std::unique_ptr<SceneNode> GenerateHierarchy(unsigned int nodeCount, unsigned int branching, std::mt19937& rng) {
+        std::unique_ptr<SceneNode> root = std::make_unique<SceneNode>("root");
+        std::vector<SceneNode*> queue = { root.get() };
+        unsigned int created = 1;
+        for (size_t i = 0; i < queue.size() && created < nodeCount; i++) {
+            for (unsigned int c = 0; c < branching && created < nodeCount; c++, created++) {
+                std::unique_ptr<SceneNode> child = std::make_unique<SceneNode>("node", queue[i]);
+                child->transform.SetPosition(RandomVector(rng, -10.0f, 10.0f));
+                child->transform.SetRotation(RandomVector(rng, 0.0f, DirectX::XM_2PI));
+                child->transform.SetScale(RandomVector(rng, 0.9f, 1.1f));
+                queue.push_back(child.get());
+                queue[i]->AddChild(std::move(child));
+            }
+        }
+        return root;
+    }
+
+    // Branches of branchLength nodes hanging from the root, one node per level each, so the
+    // hierarchy has branchLength levels of only a few nodes
+    std::unique_ptr<SceneNode> GenerateBranches(unsigned int nodeCount, unsigned int branchLength, std::mt19937& rng) {
+        std::unique_ptr<SceneNode> root = std::make_unique<SceneNode>("root");
+        unsigned int created = 1;
+        while (created < nodeCount) {
+            SceneNode* parent = root.get();
+            for (unsigned int level = 0; level < branchLength && created < nodeCount; level++, created++) {
+                std::unique_ptr<SceneNode> child = std::make_unique<SceneNode>("node", parent);
+                child->transform.SetPosition(RandomVector(rng, -1.0f, 1.0f));
+                child->transform.SetRotation(RandomVector(rng, 0.0f, 0.1f));
+                SceneNode* next = child.get();
+                parent->AddChild(std::move(child));
+                parent = next;
+            }
+        }
+        return root;
+    }
+
+    // Columns of unit boxes on a ground mesh, two units apart on a square grid, the scene
+    // of the rigid body benchmarks. Worlds keep pointers to the ground and the box hull.
+    class BoxColumns {
+    public:
+        BoxColumns(unsigned int bodyCount, unsigned int stackHeight) : m_StackHeight(stackHeight) {
+            m_ColumnCount = std::max(1u, bodyCount / stackHeight);
+            m_Rows = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(m_ColumnCount))));
+            m_GroundSize = m_Rows * SPACING + 10.0f;
+            const std::vector<Vector3> groundVertices = { Vector3(-m_GroundSize, 0.0f, -m_GroundSize), Vector3(-m_GroundSize, 0.0f, m_GroundSize),
+                Vector3(m_GroundSize, 0.0f, m_GroundSize), Vector3(m_GroundSize, 0.0f, -m_GroundSize) };
+            m_Ground.Build(groundVertices, { 0, 1, 2, 0, 2, 3 });
+            std::vector<Vector3> corners;
+            for (unsigned int i = 0; i < 8; i++) {
+                corners.push_back(Vector3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f));
+            }
+            m_Box = ConvexHull::FromPoints(corners.data(), corners.size());
+
+            const float offset = 0.5f * (m_Rows - 1) * SPACING;
+            for (unsigned int column = 0; column < m_ColumnCount; column++) {
+                for (unsigned int level = 0; level < m_StackHeight; level++) {
+                    m_StartPositions.push_back(Vector3((column % m_Rows) * SPACING - offset, 0.5f + level, (column / m_Rows) * SPACING - offset));
+                }
+            }
+        }
+
+        // Body 0 is the ground, the boxes follow column by column
+        void CreateWorld(RigidBodyWorld& world) const {
+            RigidBodyDesc groundDesc;
+            groundDesc.localSphere = BoundingSphere(Vector3::Zero, m_GroundSize * 1.5f);
+            groundDesc.mesh = &m_Ground;
+            world.AddBody(groundDesc, Vector3::Zero, Quaternion::Identity);
+
+            RigidBodyDesc boxDesc;
+            boxDesc.mass = 1.0f;
+            boxDesc.localSphere = BoundingSphere(Vector3::Zero, 0.87f);
+            boxDesc.localExtents = Vector3(0.5f);
+            boxDesc.hull = &m_Box;
+            for (const Vector3& position : m_StartPositions) {
+                world.AddBody(boxDesc, position, Quaternion::Identity);
+            }
+        }
+
+        // Boxes that slid off or sank through their stack, the slop alone lowers the top
+        // of a column by a few hundredths
+        unsigned int CountDisplaced(const RigidBodyWorld& world) const {
+            unsigned int displaced = 0;
+            for (unsigned int i = 0; i < m_StartPositions.size(); i++) {
+                const Vector3 offset = world.GetPosition(i + 1) - m_StartPositions[i];
+                displaced += std::fabs(offset.x) > 0.05f || std::fabs(offset.z) > 0.05f || std::fabs(offset.y) > 0.25f;
+            }
+            return displaced;
+        }
+
+        unsigned int GetBoxCount() const {
+            return static_cast<unsigned int>(m_StartPositions.size());
+        }
+
+    private:
+        static constexpr float SPACING = 2.0f;
+
+        unsigned int m_StackHeight;
+        unsigned int m_ColumnCount;
+        unsigned int m_Rows;
+        float m_GroundSize;
+        TriangleMesh m_Ground;
+        ConvexHull m_Box;
+        std::vector<Vector3> m_StartPositions;
+    };
+}
+
+std::vector<BenchmarkResult> Benchmarks::JobSystemScaling(unsigned int maxThreads, unsigned int itemCount) {
+    std::mt19937 rng(42);
+    std::vector<Vector3> positions(itemCount), rotations(itemCount), scales(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        positions[i] = RandomVector(rng, -100.0f, 100.0f);
+        rotations[i] = RandomVector(rng, 0.0f, DirectX::XM_2PI);
+        scales[i] = RandomVector(rng, 0.5f, 2.0f);
+    }
+    std::vector<Matrix> matrices(itemCount);
+
+    std::vector<BenchmarkResult> results;
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        double ms = MeasureMilliseconds([&]() {
+            jobs.ParallelFor(itemCount, 1024, [&](unsigned int begin, unsigned int end) {
+                for (unsigned int i = begin; i < end; i++) {
+                    matrices[i] = Transform::ComposeLocalMatrix(positions[i], rotations[i], scales[i]);
+                }
+            });
+        });
+        results.push_back({ "Job system parallel_for", threads, itemCount, ms, results.empty() ? 1.0 : results[0].milliseconds / ms });
+    }
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::TransformUpdate(unsigned int maxThreads, unsigned int nodeCount) {
+    std::mt19937 rng(42);
+    std::vector<BenchmarkResult> results;
+
+    // Branching factor, zero for the long branches
+    const std::pair<const char*, unsigned int> shapes[] = { { "wide", 16 }, { "binary", 2 }, { "long branches", 0 } };
+    for (const auto& shape : shapes) {
+        std::unique_ptr<SceneNode> root = shape.second > 0 ? GenerateHierarchy(nodeCount, shape.second, rng)
+            : GenerateBranches(nodeCount, BRANCH_LENGTH, rng);
+        TransformHierarchy hierarchy;
+        hierarchy.Build(root.get());
+
+        // Rotating the root invalidates every global matrix
+        float angle = 0.0f;
+        auto touchRoot = [&]() {
+            angle += 0.01f;
+            root->transform.SetRotation(Vector3(0.0f, angle, 0.0f));
+        };
+
+        double ms = MeasureMilliseconds([&]() {
+            touchRoot();
+            root->UpdateTransform();
+        });
+        results.push_back({ std::string("Recursive transforms, ") + shape.first, 1, nodeCount, ms });
+        const double recursiveMs = ms;
+
+        ms = MeasureMilliseconds([&]() {
+            touchRoot();
+            hierarchy.Update();
+        });
+        results.push_back({ std::string("Flat transforms, ") + shape.first, 1, nodeCount, ms, recursiveMs / ms });
+
+        // The parallel passes must give exactly the matrices of the serial one
+        root->transform.SetRotation(Vector3(0.0f, 1.0f, 0.0f));
+        hierarchy.Update();
+        std::vector<Matrix> reference(hierarchy.GetCount());
+        for (unsigned int i = 0; i < hierarchy.GetCount(); i++) {
+            reference[i] = hierarchy.GetGlobalMatrix(i);
+        }
+
+        for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+            JobSystem jobs(threads - 1);
+            ms = MeasureMilliseconds([&]() {
+                touchRoot();
+                hierarchy.Update(&jobs);
+            });
+            root->transform.SetRotation(Vector3(0.0f, 1.0f, 0.0f));
+            hierarchy.Update(&jobs);
+            unsigned int mismatches = 0;
+            for (unsigned int i = 0; i < hierarchy.GetCount(); i++) {
+                mismatches += hierarchy.GetGlobalMatrix(i) != reference[i];
+            }
+            results.push_back({ std::string("Flat transforms, ") + shape.first, threads, nodeCount, ms, recursiveMs / ms, static_cast<double>(mismatches) });
+        }
+    }
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::LocalMatrixKernels(unsigned int itemCount) {
+    std::mt19937 rng(42);
+    std::vector<float> components[9];
+    for (int c = 0; c < 9; c++) {
+        components[c].resize(itemCount);
+        for (float& value : components[c]) {
+            if (c < 3) {
+                value = std::uniform_real_distribution<float>(-100.0f, 100.0f)(rng);
+            } else if (c < 6) {
+                value = std::uniform_real_distribution<float>(-DirectX::XM_2PI, DirectX::XM_2PI)(rng);
+            } else {
+                value = std::uniform_real_distribution<float>(0.5f, 2.0f)(rng);
+            }
+        }
+    }
+    const LocalTransformArrays arrays = {
+        components[0].data(), components[1].data(), components[2].data(),
+        components[3].data(), components[4].data(), components[5].data(),
+        components[6].data(), components[7].data(), components[8].data()
+    };
+
+    std::vector<BenchmarkResult> results;
+    std::vector<Matrix> reference(itemCount);
+    double ms = MeasureMilliseconds([&]() {
+        for (unsigned int i = 0; i < itemCount; i++) {
+            reference[i] = Transform::ComposeLocalMatrix(
+                Vector3(arrays.positionX[i], arrays.positionY[i], arrays.positionZ[i]),
+                Vector3(arrays.rotationX[i], arrays.rotationY[i], arrays.rotationZ[i]),
+                Vector3(arrays.scaleX[i], arrays.scaleY[i], arrays.scaleZ[i]));
+        }
+    });
+    results.push_back({ "Transform::ComposeLocalMatrix", 1, itemCount, ms });
+    const double referenceMs = ms;
+
+    std::vector<Matrix> matrices(itemCount);
+    ms = MeasureMilliseconds([&]() {
+        TransformKernels::ComposeLocalMatricesScalar(arrays, 0, itemCount, matrices.data());
+    });
+    results.push_back({ "Scalar kernel", 1, itemCount, ms, referenceMs / ms, MaxMatrixError(reference, matrices) });
+
+#ifdef TRANSFORM_KERNELS_SSE
+    ms = MeasureMilliseconds([&]() {
+        TransformKernels::ComposeLocalMatricesSSE(arrays, 0, itemCount, matrices.data());
+    });
+    results.push_back({ "SSE kernel (4 wide)", 1, itemCount, ms, referenceMs / ms, MaxMatrixError(reference, matrices) });
+#endif
+
+#ifdef TRANSFORM_KERNELS_AVX
+    ms = MeasureMilliseconds([&]() {
+        TransformKernels::ComposeLocalMatricesAVX(arrays, 0, itemCount, matrices.data());
+    });
+    results.push_back({ "AVX kernel (8 wide)", 1, itemCount, ms, referenceMs / ms, MaxMatrixError(reference, matrices) });
+#endif
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::FrustumCullingKernels(unsigned int itemCount) {
+    std::mt19937 rng(7);
+    std::vector<float> centerX(itemCount), centerY(itemCount), centerZ(itemCount), radius(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        const Vector3 center = RandomVector(rng, -150.0f, 150.0f);
+        centerX[i] = center.x;
+        centerY[i] = center.y;
+        centerZ[i] = center.z;
+        radius[i] = std::uniform_real_distribution<float>(0.5f, 5.0f)(rng);
+    }
+    const SphereArrays spheres = { centerX.data(), centerY.data(), centerZ.data(), radius.data() };
+
+    // Default camera at the origin, roughly a sixth of the spheres end up visible
+    Camera camera("benchmark camera");
+    const Frustum frustum(camera, 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::vector<BenchmarkResult> results;
+    std::vector<uint32_t> reference(CullingKernels::GetMaskWordCount(itemCount));
+    double ms = MeasureMilliseconds([&]() {
+        std::fill(reference.begin(), reference.end(), 0);
+        for (unsigned int i = 0; i < itemCount; i++) {
+            BoundingSphere sphere(Vector3(centerX[i], centerY[i], centerZ[i]), radius[i]);
+            if (sphere.IsOnFrustum(frustum)) {
+                reference[i / 32] |= 1u << (i % 32);
+            }
+        }
+    });
+    results.push_back({ "BoundingSphere::IsOnFrustum", 1, itemCount, ms });
+    const double referenceMs = ms;
+
+    std::vector<uint32_t> visibility(reference.size());
+    ms = MeasureMilliseconds([&]() {
+        CullingKernels::TestSpheresScalar(frustum, spheres, itemCount, visibility.data());
+    });
+    results.push_back({ "Scalar culling kernel", 1, itemCount, ms, referenceMs / ms, static_cast<double>(CountMismatches(reference, visibility, itemCount)) });
+
+#ifdef CULLING_KERNELS_SSE
+    ms = MeasureMilliseconds([&]() {
+        CullingKernels::TestSpheresSSE(frustum, spheres, itemCount, visibility.data());
+    });
+    results.push_back({ "SSE culling kernel (4 wide)", 1, itemCount, ms, referenceMs / ms, static_cast<double>(CountMismatches(reference, visibility, itemCount)) });
+#endif
+
+#ifdef CULLING_KERNELS_AVX
+    ms = MeasureMilliseconds([&]() {
+        CullingKernels::TestSpheresAVX(frustum, spheres, itemCount, visibility.data());
+    });
+    results.push_back({ "AVX culling kernel (8 wide)", 1, itemCount, ms, referenceMs / ms, static_cast<double>(CountMismatches(reference, visibility, itemCount)) });
+#endif
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::ParallelCulling(unsigned int maxThreads, unsigned int itemCount) {
+    std::mt19937 rng(11);
+    std::vector<std::unique_ptr<SceneNode>> nodes;
+    RenderQueue queue;
+    for (unsigned int i = 0; i < itemCount; i++) {
+        nodes.push_back(std::make_unique<SceneNode>("instance"));
+        queue.AddCandidate(nodes.back().get(), BoundingSphere(RandomVector(rng, -150.0f, 150.0f), 2.0f));
+    }
+
+    Camera camera("benchmark camera");
+    const Frustum frustum(camera, 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::vector<BenchmarkResult> results;
+    double ms = MeasureMilliseconds([&]() {
+        queue.Cull(frustum);
+    });
+    results.push_back({ "Render queue culling", 1, itemCount, ms });
+    const double serialMs = ms;
+
+    for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        ms = MeasureMilliseconds([&]() {
+            queue.Cull(frustum, &jobs);
+        });
+        results.push_back({ "Render queue culling", threads, itemCount, ms, serialMs / ms });
+    }
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::OcclusionCulling(unsigned int itemCount) {
+    // Camera at the origin looking down +z, a wall ahead and the ground below
+    const std::vector<Quad> occluders = {
+        { Vector3(-20.0f, -2.0f, 30.0f), Vector3(40.0f, 0.0f, 0.0f), Vector3(0.0f, 12.0f, 0.0f) },
+        { Vector3(-500.0f, -2.0f, 0.0f), Vector3(1000.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 500.0f) }
+    };
+    std::vector<Vector3> positions;
+    std::vector<unsigned int> indices;
+    for (const Quad& quad : occluders) {
+        const unsigned int first = static_cast<unsigned int>(positions.size());
+        positions.push_back(quad.corner);
+        positions.push_back(quad.corner + quad.edgeU);
+        positions.push_back(quad.corner + quad.edgeU + quad.edgeV);
+        positions.push_back(quad.corner + quad.edgeV);
+        indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    }
+    const Matrix viewProjection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+    std::vector<OrientedBox> boxes;
+    for (unsigned int i = 0; i < itemCount; i++) {
+        const Vector3 center = RandomVector(rng, -1.0f, 1.0f) * Vector3(40.0f, 8.0f, 60.0f) + Vector3(0.0f, 0.0f, 90.0f);
+        const Matrix rotation = Matrix::CreateFromYawPitchRoll(RandomVector(rng, 0.0f, DirectX::XM_2PI));
+        boxes.push_back(OrientedBox(Vector3::Zero, Vector3::UnitX * size(rng), Vector3::UnitY * size(rng), Vector3::UnitZ * size(rng))
+            .Transformed(rotation * Matrix::CreateTranslation(center)));
+    }
+
+    std::vector<BenchmarkResult> results;
+    OcclusionBuffer buffer;
+    double ms = MeasureMilliseconds([&]() {
+        buffer.Clear(viewProjection);
+        buffer.RasterizeTriangles(positions.data(), positions.size(), sizeof(Vector3), indices.data(), indices.size(), Matrix::Identity);
+    });
+    results.push_back({ "Occluder rasterization " + std::to_string(buffer.GetWidth()) + "x" + std::to_string(buffer.GetHeight()),
+        1, buffer.GetRasterizedTriangleCount(), ms });
+
+    ms = MeasureMilliseconds([&]() {
+        buffer.BuildHierarchy();
+    });
+    results.push_back({ "Hi-Z pyramid build", 1, buffer.GetWidth() * buffer.GetHeight(), ms });
+
+    std::vector<uint8_t> visible(itemCount);
+    ms = MeasureMilliseconds([&]() {
+        for (unsigned int i = 0; i < itemCount; i++) {
+            visible[i] = buffer.IsVisible(boxes[i]);
+        }
+    });
+
+    unsigned int hidden = 0, culled = 0, falseOcclusions = 0;
+    for (unsigned int i = 0; i < itemCount; i++) {
+        const bool reference = IsVisibleFromOrigin(boxes[i], occluders);
+        hidden += !reference;
+        culled += !visible[i];
+        falseOcclusions += reference && !visible[i];
+    }
+    results.push_back({ "Occlusion test, " + std::to_string(culled) + " of " + std::to_string(hidden) + " hidden culled",
+        1, itemCount, ms, 1.0, static_cast<double>(falseOcclusions) });
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::SpatialQueries(unsigned int itemCount) {
+    const unsigned int QUERY_COUNT = 100;
+    // Constant density, about one box per 8 units cubed
+    const float halfSize = std::cbrt(static_cast<float>(itemCount));
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> extent(0.1f, 1.0f);
+    std::vector<AxisAlignedBox> boxes(itemCount);
+    for (AxisAlignedBox& box : boxes) {
+        const Vector3 center = RandomVector(rng, -halfSize, halfSize);
+        const Vector3 extents(extent(rng), extent(rng), extent(rng));
+        box = AxisAlignedBox(center - extents, center + extents);
+    }
+
+    std::vector<BenchmarkResult> results;
+    DynamicAabbTree tree;
+    std::vector<int> proxies(itemCount);
+    double ms = MeasureMilliseconds([&]() {
+        tree.Clear();
+        for (unsigned int i = 0; i < itemCount; i++) {
+            proxies[i] = tree.Insert(boxes[i], &boxes[i]);
+        }
+    });
+    results.push_back({ "AABB tree build, height " + std::to_string(tree.GetHeight()), 1, itemCount, ms });
+
+    // Every repetition moves the same boxes a bit further, most stay inside their fat box
+    const unsigned int movedCount = std::max(1u, itemCount / 100);
+    ms = MeasureMilliseconds([&]() {
+        for (unsigned int i = 0; i < movedCount; i++) {
+            const unsigned int index = i * 100 % itemCount;
+            boxes[index] = AxisAlignedBox(boxes[index].lower + Vector3(0.05f), boxes[index].upper + Vector3(0.05f));
+            tree.Update(proxies[index], boxes[index]);
+        }
+    });
+    results.push_back({ "AABB tree update (1% moved)", 1, movedCount, ms });
+
+    auto addComparison = [&](const std::string& name, unsigned int queries, auto&& linear, auto&& query) {
+        unsigned int linearHits = 0, treeHits = 0;
+        const double linearMs = MeasureMilliseconds([&]() {
+            linearHits = linear();
+        });
+        const double treeMs = MeasureMilliseconds([&]() {
+            treeHits = query();
+        });
+        results.push_back({ name + " linear scan", 1, queries, linearMs });
+        results.push_back({ name + " AABB tree", 1, queries, treeMs, linearMs / treeMs,
+            static_cast<double>(linearHits > treeHits ? linearHits - treeHits : treeHits - linearHits) });
+    };
+
+    Camera camera("benchmark camera");
+    const Frustum frustum(camera, 16.0f / 9.0f, 0.1f, halfSize * 0.5f);
+    addComparison("Frustum query", 1, [&]() {
+        unsigned int hits = 0;
+        for (const AxisAlignedBox& box : boxes) {
+            hits += box.Classify(frustum) != FrustumIntersection::Outside;
+        }
+        return hits;
+    }, [&]() {
+        unsigned int hits = 0;
+        tree.QueryFrustum(frustum, [&](int proxy, bool inside) {
+            hits += inside || static_cast<const AxisAlignedBox*>(tree.GetUserData(proxy))->Classify(frustum) != FrustumIntersection::Outside;
+        });
+        return hits;
+    });
+
+    std::vector<AxisAlignedBox> queryBoxes;
+    std::vector<BoundingSphere> querySpheres;
+    std::vector<std::pair<Vector3, Vector3>> rays;
+    for (unsigned int q = 0; q < QUERY_COUNT; q++) {
+        const Vector3 center = RandomVector(rng, -halfSize, halfSize);
+        queryBoxes.push_back(AxisAlignedBox(center - Vector3(3.0f), center + Vector3(3.0f)));
+        querySpheres.push_back(BoundingSphere(RandomVector(rng, -halfSize, halfSize), 3.0f));
+        Vector3 direction = RandomVector(rng, -1.0f, 1.0f);
+        direction.Normalize();
+        rays.push_back({ RandomVector(rng, -halfSize, halfSize), direction });
+    }
+
+    addComparison("Box query", QUERY_COUNT, [&]() {
+        unsigned int hits = 0;
+        for (const AxisAlignedBox& queryBox : queryBoxes) {
+            for (const AxisAlignedBox& box : boxes) {
+                hits += box.Overlaps(queryBox);
+            }
+        }
+        return hits;
+    }, [&]() {
+        unsigned int hits = 0;
+        for (const AxisAlignedBox& queryBox : queryBoxes) {
+            tree.QueryBox(queryBox, [&](int proxy) {
+                hits += static_cast<const AxisAlignedBox*>(tree.GetUserData(proxy))->Overlaps(queryBox);
+            });
+        }
+        return hits;
+    });
+
+    addComparison("Sphere query", QUERY_COUNT, [&]() {
+        unsigned int hits = 0;
+        for (const BoundingSphere& sphere : querySpheres) {
+            for (const AxisAlignedBox& box : boxes) {
+                hits += box.Overlaps(sphere);
+            }
+        }
+        return hits;
+    }, [&]() {
+        unsigned int hits = 0;
+        for (const BoundingSphere& sphere : querySpheres) {
+            tree.QuerySphere(sphere, [&](int proxy) {
+                hits += static_cast<const AxisAlignedBox*>(tree.GetUserData(proxy))->Overlaps(sphere);
+            });
+        }
+        return hits;
+    });
+
+    // Closest hit along each ray, compared through the number of rays hitting something
+    const float rayLength = 2.0f * halfSize;
+    addComparison("Ray cast", QUERY_COUNT, [&]() {
+        unsigned int hits = 0;
+        for (const auto& ray : rays) {
+            const Vector3 inverseDirection(1.0f / ray.second.x, 1.0f / ray.second.y, 1.0f / ray.second.z);
+            bool hit = false;
+            float distance;
+            for (const AxisAlignedBox& box : boxes) {
+                hit = hit || box.IntersectRay(ray.first, inverseDirection, rayLength, distance);
+            }
+            hits += hit;
+        }
+        return hits;
+    }, [&]() {
+        unsigned int hits = 0;
+        for (const auto& ray : rays) {
+            const Vector3 inverseDirection(1.0f / ray.second.x, 1.0f / ray.second.y, 1.0f / ray.second.z);
+            bool hit = false;
+            tree.RayCast(ray.first, ray.second, rayLength, [&](int proxy, float maxDistance) {
+                float distance;
+                if (static_cast<const AxisAlignedBox*>(tree.GetUserData(proxy))->IntersectRay(ray.first, inverseDirection, maxDistance, distance)) {
+                    hit = true;
+                    return distance;
+                }
+                return maxDistance;
+            });
+            hits += hit;
+        }
+        return hits;
+    });
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::Broadphase(unsigned int itemCount) {
+    // Constant density, a sphere touches about one other on average
+    const float halfSize = std::cbrt(static_cast<float>(itemCount));
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<float> radius(0.2f, 0.6f);
+    std::vector<BoundingSphere> spheres(itemCount);
+    for (BoundingSphere& sphere : spheres) {
+        sphere = BoundingSphere(RandomVector(rng, -halfSize, halfSize), radius(rng));
+    }
+    // Next frame, every sphere moved by up to a tenth of the smallest radius
+    std::vector<BoundingSphere> movedSpheres(spheres);
+    for (BoundingSphere& sphere : movedSpheres) {
+        sphere.center += RandomVector(rng, -0.02f, 0.02f);
+    }
+    const std::vector<AxisAlignedBox> bounds = ToBounds(spheres);
+    const std::vector<AxisAlignedBox> movedBounds = ToBounds(movedSpheres);
+    // Everything collides, as in the all-pairs loop
+    const std::vector<CollisionFilter> filters(itemCount);
+
+    std::vector<BenchmarkResult> results;
+    unsigned int referenceCollisions = 0;
+    // Quadratic, a single run is long enough past a few thousand spheres
+    const double allPairsMs = MeasureMilliseconds([&]() {
+        referenceCollisions = CountCollisionsAllPairs(spheres);
+    }, itemCount > 5000 ? 1 : BENCHMARK_REPETITIONS);
+    results.push_back({ "All pairs", 1, itemCount, allPairsMs });
+
+    std::vector<BodyPair> pairs;
+    auto addResult = [&](const std::string& name, double ms, unsigned int collisions, unsigned int expected) {
+        results.push_back({ name + ", " + std::to_string(pairs.size()) + " candidates", 1, itemCount, ms, allPairsMs / ms,
+            static_cast<double>(Difference(collisions, expected)) });
+    };
+
+    unsigned int collisions = 0;
+    double ms = MeasureMilliseconds([&]() {
+        SweepAndPrune sweepAndPrune;
+        pairs.clear();
+        sweepAndPrune.FindPairs(bounds, filters, pairs);
+        collisions = CountCollisions(pairs, spheres);
+    });
+    addResult("Sweep and prune, full sort", ms, collisions, referenceCollisions);
+
+    // Alternates between the two frames, each call repairs the order of the previous one
+    SweepAndPrune sweepAndPrune;
+    sweepAndPrune.FindPairs(bounds, filters, pairs);
+    unsigned int frame = 0;
+    unsigned int swaps = 0;
+    ms = MeasureMilliseconds([&]() {
+        frame++;
+        pairs.clear();
+        sweepAndPrune.FindPairs(frame % 2 ? movedBounds : bounds, filters, pairs);
+        collisions = CountCollisions(pairs, frame % 2 ? movedSpheres : spheres);
+        swaps = sweepAndPrune.GetSwapCount();
+    });
+    // The last frame checked against a full sort of the same boxes
+    unsigned int expectedCollisions = referenceCollisions;
+    if (frame % 2) {
+        SweepAndPrune reference;
+        pairs.clear();
+        reference.FindPairs(movedBounds, filters, pairs);
+        expectedCollisions = CountCollisions(pairs, movedSpheres);
+    }
+    addResult("Sweep and prune, next frame (" + std::to_string(swaps) + " swaps)", ms, collisions, expectedCollisions);
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::GridBroadphase(unsigned int itemCount) {
+    // Spheres up to 1.2 across, the cell fits the largest
+    const float CELL_SIZE = 1.25f;
+    std::vector<BenchmarkResult> results;
+    std::mt19937 rng(29);
+    std::uniform_real_distribution<float> radius(0.2f, 0.6f);
+    // Spheres per unit cubed
+    const std::pair<const char*, float> densities[] = { { "sparse", 0.01f }, { "medium", 0.1f }, { "dense", 0.5f } };
+    for (const auto& density : densities) {
+        const float halfSize = 0.5f * std::cbrt(itemCount / density.second);
+        std::vector<BoundingSphere> spheres(itemCount);
+        for (BoundingSphere& sphere : spheres) {
+            sphere = BoundingSphere(RandomVector(rng, -halfSize, halfSize), radius(rng));
+        }
+        const std::vector<AxisAlignedBox> bounds = ToBounds(spheres);
+        const std::vector<CollisionFilter> filters(itemCount);
+        const std::string densityName = density.first;
+
+        unsigned int referenceCollisions = 0;
+        const double allPairsMs = MeasureMilliseconds([&]() {
+            referenceCollisions = CountCollisionsAllPairs(spheres);
+        }, itemCount > 5000 ? 1 : BENCHMARK_REPETITIONS);
+        results.push_back({ "All pairs, " + densityName, 1, itemCount, allPairsMs });
+
+        auto addBroadphase = [&](const std::string& name, ::Broadphase& broadphase) {
+            std::vector<BodyPair> pairs;
+            unsigned int collisions = 0;
+            const double ms = MeasureMilliseconds([&]() {
+                pairs.clear();
+                broadphase.FindPairs(bounds, filters, pairs);
+                collisions = CountCollisions(pairs, spheres);
+            });
+            results.push_back({ name + ", " + densityName, 1, itemCount, ms, allPairsMs / ms,
+                static_cast<double>(Difference(collisions, referenceCollisions)) });
+        };
+        // Sorted from scratch, the grid has no frame to frame state either
+        SweepAndPrune sweepAndPrune;
+        addBroadphase("Sweep and prune", sweepAndPrune);
+        SpatialHashGrid grid(CELL_SIZE);
+        addBroadphase("Spatial hash grid", grid);
+    }
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::ParallelNarrowphase(unsigned int maxThreads, unsigned int itemCount) {
+    // One sphere per unit cubed, each one overlaps about a dozen others
+    const float halfSize = 0.5f * std::cbrt(static_cast<float>(itemCount));
+    std::mt19937 rng(31);
+    std::uniform_real_distribution<float> radius(0.4f, 0.9f);
+    std::vector<BoundingSphere> spheres(itemCount);
+    std::vector<CollisionBody> bodies(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        spheres[i] = BoundingSphere(RandomVector(rng, -halfSize, halfSize), radius(rng));
+        bodies[i] = { spheres[i], nullptr, Matrix::CreateTranslation(spheres[i].center) };
+    }
+    std::vector<BodyPair> pairs;
+    SpatialHashGrid grid(1.8f);
+    grid.FindPairs(ToBounds(spheres), std::vector<CollisionFilter>(itemCount), pairs);
+    const unsigned int pairCount = static_cast<unsigned int>(pairs.size());
+
+    auto countDifferences = [](const std::vector<Contact>& reference, const std::vector<Contact>& contacts) {
+        unsigned int differences = Difference(static_cast<unsigned int>(reference.size()), static_cast<unsigned int>(contacts.size()));
+        for (size_t i = 0; i < std::min(reference.size(), contacts.size()); i++) {
+            const Contact& a = reference[i];
+            const Contact& b = contacts[i];
+            differences += a.first != b.first || a.second != b.second || a.normal != b.normal || a.point != b.point || a.depth != b.depth;
+        }
+        return differences;
+    };
+    auto pairsPerSecond = [&](double ms) {
+        return std::to_string(static_cast<unsigned int>(pairCount / ms / 1000.0)) + " M pairs/s";
+    };
+
+    std::vector<BenchmarkResult> results;
+    ::Narrowphase serial;
+    const double serialMs = MeasureMilliseconds([&]() {
+        serial.Run(bodies, pairs);
+    });
+    results.push_back({ "Narrowphase, " + pairsPerSecond(serialMs), 1, pairCount, serialMs });
+
+    for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        ::Narrowphase narrowphase;
+        const double ms = MeasureMilliseconds([&]() {
+            narrowphase.Run(bodies, pairs, &jobs);
+        });
+        results.push_back({ "Narrowphase, " + pairsPerSecond(ms), threads, pairCount, ms, serialMs / ms,
+            static_cast<double>(countDifferences(serial.GetContacts(), narrowphase.GetContacts())) });
+    }
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::ConvexHulls(unsigned int itemCount) {
+    std::mt19937 rng(37);
+    std::vector<BenchmarkResult> results;
+
+    // Points in a flattened ball, the hull keeps the ones near its surface
+    std::vector<Vector3> points(itemCount);
+    for (Vector3& point : points) {
+        Vector3 direction = RandomVector(rng, -1.0f, 1.0f);
+        direction.Normalize();
+        point = direction * std::uniform_real_distribution<float>(0.8f, 1.0f)(rng) * Vector3(1.0f, 0.6f, 0.8f);
+    }
+    ConvexHull hull;
+    const double buildMs = MeasureMilliseconds([&]() {
+        hull = ConvexHull::FromPoints(points.data(), points.size());
+    });
+    // Points left outside any hull face
+    unsigned int outside = 0;
+    for (const Vector3& point : points) {
+        for (size_t i = 0; i < hull.indices.size(); i += 3) {
+            const Vector3& a = hull.vertices[hull.indices[i]];
+            Vector3 normal = (hull.vertices[hull.indices[i + 1]] - a).Cross(hull.vertices[hull.indices[i + 2]] - a);
+            normal.Normalize();
+            if (normal.Dot(point - a) > 1e-4f) {
+                outside++;
+                break;
+            }
+        }
+    }
+    results.push_back({ "Quickhull, " + std::to_string(hull.vertices.size()) + " hull vertices", 1, itemCount, buildMs,
+        1.0, static_cast<double>(outside) });
+
+    // Rotated copies of a smaller hull, placed so most sphere tests pass and about half
+    // of the hulls really overlap
+    const ConvexHull pairHull = ConvexHull::FromPoints(points.data(), std::min<size_t>(points.size(), 256));
+    const unsigned int PAIR_COUNT = 10000;
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::vector<CollisionBody> bodies(2 * PAIR_COUNT);
+    std::vector<BodyPair> pairs(PAIR_COUNT);
+    for (unsigned int i = 0; i < PAIR_COUNT; i++) {
+        for (unsigned int j = 0; j < 2; j++) {
+            const Vector3 center = j == 0 ? Vector3::Zero : RandomVector(rng, -1.6f, 1.6f);
+            const Matrix worldMatrix = Matrix::CreateFromYawPitchRoll(angle(rng), angle(rng), angle(rng)) * Matrix::CreateTranslation(center);
+            bodies[2 * i + j] = { BoundingSphere(center, 1.0f), &pairHull, worldMatrix };
+        }
+        pairs[i] = { 2 * i, 2 * i + 1 };
+    }
+    auto nanosecondsPerPair = [&](double ms) {
+        return std::to_string(static_cast<unsigned int>(ms * 1e6 / PAIR_COUNT)) + " ns/pair";
+    };
+
+    unsigned int hits = 0;
+    const double sphereMs = MeasureMilliseconds([&]() {
+        hits = 0;
+        Contact contact;
+        for (const BodyPair& pair : pairs) {
+            hits += ::Narrowphase::TestSpheres(bodies[pair.first].sphere, bodies[pair.second].sphere, contact);
+        }
+    });
+    results.push_back({ "Sphere test, " + nanosecondsPerPair(sphereMs) + ", " + std::to_string(hits) + " hits", 1, PAIR_COUNT, sphereMs });
+
+    const double intersectMs = MeasureMilliseconds([&]() {
+        hits = 0;
+        for (const BodyPair& pair : pairs) {
+            hits += Gjk::Intersect(ConvexShape(pairHull, bodies[pair.first].worldMatrix), ConvexShape(pairHull, bodies[pair.second].worldMatrix));
+        }
+    });
+    results.push_back({ "GJK, " + nanosecondsPerPair(intersectMs) + ", " + std::to_string(hits) + " hits", 1, PAIR_COUNT, intersectMs });
+
+    const double penetrationMs = MeasureMilliseconds([&]() {
+        hits = 0;
+        Vector3 normal, point;
+        float depth;
+        for (const BodyPair& pair : pairs) {
+            hits += Gjk::Penetration(ConvexShape(pairHull, bodies[pair.first].worldMatrix), ConvexShape(pairHull, bodies[pair.second].worldMatrix),
+                normal, depth, point);
+        }
+    });
+    results.push_back({ "GJK and EPA, " + nanosecondsPerPair(penetrationMs) + ", " + std::to_string(hits) + " hits", 1, PAIR_COUNT, penetrationMs });
+
+    // Moving b just past the reported depth along the normal has to separate the hulls,
+    // moving it just short of it has to leave them overlapping
+    ::Narrowphase narrowphase;
+    const double narrowphaseMs = MeasureMilliseconds([&]() {
+        narrowphase.Run(bodies, pairs);
+    });
+    const float MARGIN = 1e-2f;
+    unsigned int wrongDepths = 0;
+    for (const Contact& contact : narrowphase.GetContacts()) {
+        const ConvexShape a(pairHull, bodies[contact.first].worldMatrix);
+        const Matrix& worldMatrix = bodies[contact.second].worldMatrix;
+        const bool separated = !Gjk::Intersect(a,
+            ConvexShape(pairHull, worldMatrix * Matrix::CreateTranslation(contact.normal * (contact.depth + MARGIN))));
+        const bool overlapping = contact.depth <= MARGIN || Gjk::Intersect(a,
+            ConvexShape(pairHull, worldMatrix * Matrix::CreateTranslation(contact.normal * (contact.depth - MARGIN))));
+        wrongDepths += !separated || !overlapping;
+    }
+    results.push_back({ "Spheres, GJK and EPA, " + nanosecondsPerPair(narrowphaseMs) + ", " + std::to_string(narrowphase.GetContacts().size()) + " contacts",
+        1, PAIR_COUNT, narrowphaseMs, penetrationMs / narrowphaseMs, static_cast<double>(wrongDepths) });
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::MeshColliders(unsigned int triangleCount) {
+    // Rolling terrain on a square grid, two triangles per cell
+    const unsigned int cells = std::max(1u, static_cast<unsigned int>(std::sqrt(triangleCount / 2.0f)));
+    const float size = 100.0f;
+    const float cellSize = size / cells;
+    std::vector<Vector3> vertices;
+    for (unsigned int z = 0; z <= cells; z++) {
+        for (unsigned int x = 0; x <= cells; x++) {
+            const float px = x * cellSize - 0.5f * size;
+            const float pz = z * cellSize - 0.5f * size;
+            vertices.push_back(Vector3(px, 2.0f * std::sin(0.2f * px) * std::cos(0.15f * pz), pz));
+        }
+    }
+    std::vector<unsigned int> indices;
+    for (unsigned int z = 0; z < cells; z++) {
+        for (unsigned int x = 0; x < cells; x++) {
+            const unsigned int corner = z * (cells + 1) + x;
+            for (unsigned int index : { corner, corner + cells + 1, corner + 1, corner + 1, corner + cells + 1, corner + cells + 2 }) {
+                indices.push_back(index);
+            }
+        }
+    }
+    const unsigned int meshTriangles = static_cast<unsigned int>(indices.size() / 3);
+
+    std::vector<BenchmarkResult> results;
+    TriangleMesh mesh;
+    const double buildMs = MeasureMilliseconds([&]() {
+        mesh.Build(vertices, indices);
+    });
+    results.push_back({ "BVH build, " + std::to_string(mesh.GetNodeCount()) + " nodes", 1, meshTriangles, buildMs });
+
+    // Spheres around the terrain surface, about a quarter of them touch it. The mesh body is scaled
+    // and moved so the query box takes the round trip through mesh space.
+    const unsigned int QUERY_COUNT = 1000;
+    std::mt19937 rng(41);
+    std::uniform_real_distribution<float> radius(0.3f, 1.0f);
+    const Matrix meshMatrix = Matrix::CreateScale(Vector3(2.0f, 1.0f, 2.0f)) * Matrix::CreateTranslation(Vector3(0.0f, -1.0f, 0.0f));
+    const CollisionBody meshBody = { BoundingSphere(Vector3(0.0f, -1.0f, 0.0f), size * 1.5f), nullptr, meshMatrix, &mesh };
+    std::uniform_real_distribution<float> horizontal(-size, size);
+    std::uniform_real_distribution<float> height(-3.0f, 2.0f);
+    std::vector<CollisionBody> spheres(QUERY_COUNT);
+    for (CollisionBody& body : spheres) {
+        const Vector3 center(horizontal(rng), height(rng), horizontal(rng));
+        body = { BoundingSphere(center, radius(rng)), nullptr, Matrix::CreateTranslation(center) };
+    }
+
+    // Every triangle in world space against every sphere
+    std::vector<float> referenceDepths(QUERY_COUNT);
+    const double linearMs = MeasureMilliseconds([&]() {
+        for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+            float deepest = -1.0f;
+            Contact contact;
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                if (::Narrowphase::TestSphereTriangle(spheres[i].sphere, Vector3::Transform(vertices[indices[t]], meshMatrix),
+                    Vector3::Transform(vertices[indices[t + 1]], meshMatrix), Vector3::Transform(vertices[indices[t + 2]], meshMatrix), contact)) {
+                    deepest = std::max(deepest, contact.depth);
+                }
+            }
+            referenceDepths[i] = deepest;
+        }
+    }, 1);
+    results.push_back({ "Spheres, all triangles", 1, QUERY_COUNT, linearMs });
+
+    std::vector<float> depths(QUERY_COUNT);
+    unsigned int contacts = 0;
+    const double bvhMs = MeasureMilliseconds([&]() {
+        contacts = 0;
+        for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+            Contact contact;
+            depths[i] = ::Narrowphase::TestMesh(meshBody, spheres[i], contact) ? contact.depth : -1.0f;
+            contacts += depths[i] >= 0.0f;
+        }
+    });
+    unsigned int differences = 0;
+    for (unsigned int i = 0; i < QUERY_COUNT; i++) {
+        differences += std::fabs(depths[i] - referenceDepths[i]) > 1e-4f;
+    }
+    results.push_back({ "Spheres, BVH, " + std::to_string(contacts) + " contacts", 1, QUERY_COUNT, bvhMs, linearMs / bvhMs,
+        static_cast<double>(differences) });
+
+    // The same bodies as hulls of a rounded box, tested with GJK and EPA per triangle
+    std::vector<Vector3> boxPoints;
+    for (unsigned int i = 0; i < 64; i++) {
+        Vector3 direction = RandomVector(rng, -1.0f, 1.0f);
+        direction.Normalize();
+        boxPoints.push_back(Vector3::Max(Vector3(-1.0f), Vector3::Min(direction * 1.2f, Vector3(1.0f))));
+    }
+    const ConvexHull hull = ConvexHull::FromPoints(boxPoints.data(), boxPoints.size());
+    std::vector<CollisionBody> hulls(spheres);
+    for (CollisionBody& body : hulls) {
+        body.worldMatrix = Matrix::CreateScale(body.sphere.radius / 1.8f) * body.worldMatrix;
+        body.hull = &hull;
+    }
+    const double hullMs = MeasureMilliseconds([&]() {
+        contacts = 0;
+        for (const CollisionBody& body : hulls) {
+            Contact contact;
+            contacts += ::Narrowphase::TestMesh(meshBody, body, contact);
+        }
+    });
+    results.push_back({ "Hulls, BVH, " + std::to_string(contacts) + " contacts", 1, QUERY_COUNT, hullMs });
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::RigidBodies(unsigned int maxThreads, unsigned int bodyCount) {
+    // One second of simulation
+    const unsigned int STEP_COUNT = 60;
+    const float TIMESTEP = 1.0f / 60.0f;
+    const BoxColumns scene(bodyCount, 5);
+
+    std::vector<BenchmarkResult> results;
+    EngineSettings settings;
+    // Columns settling for a second, the timings shouldn't depend on islands falling asleep
+    settings.sleeping = false;
+    double serialMs = 0.0;
+    for (bool warmStarting : { false, true }) {
+        settings.warmStarting = warmStarting;
+        RigidBodyWorld world;
+        scene.CreateWorld(world);
+        const double ms = MeasureMilliseconds([&]() {
+            for (unsigned int step = 0; step < STEP_COUNT; step++) {
+                world.Step(TIMESTEP, settings);
+            }
+        }, 1) / STEP_COUNT;
+        if (warmStarting) {
+            serialMs = ms;
+        }
+        results.push_back({ std::string(warmStarting ? "Warm started" : "Cold started") + ", " + std::to_string(world.GetManifoldPointCount())
+            + " contact points", 1, scene.GetBoxCount(), ms, 1.0, static_cast<double>(scene.CountDisplaced(world)) });
+    }
+
+    // The narrowphase and the islands run on the workers
+    for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        RigidBodyWorld world;
+        scene.CreateWorld(world);
+        const double ms = MeasureMilliseconds([&]() {
+            for (unsigned int step = 0; step < STEP_COUNT; step++) {
+                world.Step(TIMESTEP, settings, &jobs);
+            }
+        }, 1) / STEP_COUNT;
+        results.push_back({ "Warm started", threads, scene.GetBoxCount(), ms, serialMs / ms, static_cast<double>(scene.CountDisplaced(world)) });
+    }
+
+    return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::Islands(unsigned int maxThreads, unsigned int bodyCount) {
+    // Three seconds to settle, then one more second is timed
+    const unsigned int SETTLE_STEPS = 180;
+    const unsigned int STEP_COUNT = 60;
+    const float TIMESTEP = 1.0f / 60.0f;
+    const BoxColumns scene(bodyCount, 5);
+
+    auto simulate = [&](const EngineSettings& settings, JobSystem* jobs, RigidBodyWorld& world) {
+        scene.CreateWorld(world);
+        for (unsigned int step = 0; step < SETTLE_STEPS; step++) {
+            world.Step(TIMESTEP, settings, jobs);
+        }
+        return MeasureMilliseconds([&]() {
+            for (unsigned int step = 0; step < STEP_COUNT; step++) {
+                world.Step(TIMESTEP, settings, jobs);
+            }
+        }, 1) / STEP_COUNT;
+    };
+    auto describe = [](const char* name, const RigidBodyWorld& world) {
+        return std::string(name) + ", " + std::to_string(world.GetAwakeBodyCount()) + " awake in " + std::to_string(world.GetIslandCount()) + " islands";
+    };
+
+    std::vector<BenchmarkResult> results;
+    EngineSettings settings;
+    settings.sleeping = false;
+    RigidBodyWorld awakeWorld;
+    const double awakeMs = simulate(settings, nullptr, awakeWorld);
+    results.push_back({ describe("Always awake", awakeWorld), 1, scene.GetBoxCount(), awakeMs, 1.0,
+        static_cast<double>(scene.CountDisplaced(awakeWorld)) });
+
+    settings.sleeping = true;
+    RigidBodyWorld sleepingWorld;
+    const double sleepingMs = simulate(settings, nullptr, sleepingWorld);
+    results.push_back({ describe("Sleeping", sleepingWorld), 1, scene.GetBoxCount(), sleepingMs, awakeMs / sleepingMs,
+        static_cast<double>(scene.CountDisplaced(sleepingWorld)) });
+
+    // Awake islands spread over the workers
+    settings.sleeping = false;
+    for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        RigidBodyWorld world;
+        const double ms = simulate(settings, &jobs, world);
+        results.push_back({ describe("Parallel islands", world), threads, scene.GetBoxCount(), ms, awakeMs / ms,
+            static_cast<double>(scene.CountDisplaced(world)) });
+    }
+
+    return results;
+}
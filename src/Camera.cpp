@@ -26,7 +26,7 @@ float Camera::GetFov() const {
 void Camera::GenerateViewMatrix() {
     Vector3 up = Vector3::Up;
     Vector3 lookAt = Vector3::Backward;
-    Matrix rotationMatrix = Matrix::CreateFromYawPitchRoll(transform.rotation);
+    Matrix rotationMatrix = Matrix::CreateFromQuaternion(transform.GetOrientation());
 
     up = Vector3::Transform(up, rotationMatrix);
     lookAt = Vector3::Transform(lookAt, rotationMatrix);
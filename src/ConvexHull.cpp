@@ -0,0 +1,510 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+    struct HullFace {
+        unsigned int v[3];
+        Vector3 normal;
+        float offset;
+        // Points in front of the face that no earlier face claimed, the farthest first
+        std::vector<unsigned int> outside;
+        bool alive;
+    };
+
+    struct HullBuilder {
+        const uint8_t* bytes;
+        size_t stride;
+        float epsilon;
+        std::vector<HullFace> faces;
+
+        const Vector3& Point(unsigned int index) const {
+            return *reinterpret_cast<const Vector3*>(bytes + index * stride);
+        }
+
+        float Distance(const HullFace& face, unsigned int index) const {
+            return face.normal.Dot(Point(index)) - face.offset;
+        }
+
+        // The winding decides the side, the caller makes sure it faces outwards
+        void AddFace(unsigned int a, unsigned int b, unsigned int c) {
+            HullFace face;
+            face.v[0] = a;
+            face.v[1] = b;
+            face.v[2] = c;
+            face.normal = (Point(b) - Point(a)).Cross(Point(c) - Point(a));
+            face.normal.Normalize();
+            face.offset = face.normal.Dot(Point(a));
+            face.alive = true;
+            faces.push_back(std::move(face));
+        }
+
+        // Gives each point to the first new face it is in front of
+        void AssignPoints(const std::vector<unsigned int>& points, size_t firstFace) {
+            for (unsigned int point : points) {
+                for (size_t f = firstFace; f < faces.size(); f++) {
+                    HullFace& face = faces[f];
+                    const float distance = Distance(face, point);
+                    if (distance > epsilon) {
+                        face.outside.push_back(point);
+                        if (distance > Distance(face, face.outside.front())) {
+                            std::swap(face.outside.front(), face.outside.back());
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        void AddPoint(unsigned int eye) {
+            std::vector<size_t> visible;
+            for (size_t f = 0; f < faces.size(); f++) {
+                if (faces[f].alive && Distance(faces[f], eye) > epsilon) {
+                    visible.push_back(f);
+                }
+            }
+
+            // Edges of the visible region whose reverse isn't in it border a hidden face
+            std::vector<std::pair<unsigned int, unsigned int>> edges;
+            for (size_t f : visible) {
+                for (int e = 0; e < 3; e++) {
+                    edges.push_back({ faces[f].v[e], faces[f].v[(e + 1) % 3] });
+                }
+            }
+            std::vector<unsigned int> orphans;
+            for (size_t f : visible) {
+                faces[f].alive = false;
+                for (unsigned int point : faces[f].outside) {
+                    if (point != eye) {
+                        orphans.push_back(point);
+                    }
+                }
+                faces[f].outside.clear();
+                faces[f].outside.shrink_to_fit();
+            }
+
+            const size_t firstFace = faces.size();
+            for (const auto& edge : edges) {
+                const bool shared = std::find(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first)) != edges.end();
+                if (!shared) {
+                    // Same winding as the removed face, so the new face also points outwards
+                    AddFace(edge.first, edge.second, eye);
+                }
+            }
+            AssignPoints(orphans, firstFace);
+        }
+    };
+}
+
+ConvexHull ConvexHull::FromPoints(const Vector3* points, size_t count, size_t stride) {
+    ConvexHull hull;
+    if (count < 4) {
+        return hull;
+    }
+
+    HullBuilder builder;
+    builder.bytes = reinterpret_cast<const uint8_t*>(points);
+    builder.stride = stride;
+    const unsigned int pointCount = static_cast<unsigned int>(count);
+
+    // Initial tetrahedron: the farthest pair of axis extremes, the point farthest from
+    // their line and the point farthest from the plane of the three
+    unsigned int extremes[6] = {};
+    Vector3 lower(FLT_MAX), upper(-FLT_MAX);
+    for (unsigned int i = 0; i < pointCount; i++) {
+        const Vector3& p = builder.Point(i);
+        for (int axis = 0; axis < 3; axis++) {
+            if ((&p.x)[axis] < (&builder.Point(extremes[2 * axis]).x)[axis]) {
+                extremes[2 * axis] = i;
+            }
+            if ((&p.x)[axis] > (&builder.Point(extremes[2 * axis + 1]).x)[axis]) {
+                extremes[2 * axis + 1] = i;
+            }
+        }
+        lower = Vector3::Min(lower, p);
+        upper = Vector3::Max(upper, p);
+    }
+    // Relative to the size of the point set, as in qhull
+    builder.epsilon = 3.0f * FLT_EPSILON * (std::fabs(lower.x) + std::fabs(upper.x)
+        + std::fabs(lower.y) + std::fabs(upper.y) + std::fabs(lower.z) + std::fabs(upper.z));
+
+    unsigned int i0 = 0, i1 = 0;
+    float bestDistance = 0.0f;
+    for (int a = 0; a < 6; a++) {
+        for (int b = a + 1; b < 6; b++) {
+            const float distance = Vector3::DistanceSquared(builder.Point(extremes[a]), builder.Point(extremes[b]));
+            if (distance > bestDistance) {
+                bestDistance = distance;
+                i0 = extremes[a];
+                i1 = extremes[b];
+            }
+        }
+    }
+    if (std::sqrt(bestDistance) <= builder.epsilon) {
+        return hull;
+    }
+
+    const Vector3 lineDirection = (builder.Point(i1) - builder.Point(i0)) / std::sqrt(bestDistance);
+    unsigned int i2 = 0;
+    bestDistance = 0.0f;
+    for (unsigned int i = 0; i < pointCount; i++) {
+        const float distance = (builder.Point(i) - builder.Point(i0)).Cross(lineDirection).LengthSquared();
+        if (distance > bestDistance) {
+            bestDistance = distance;
+            i2 = i;
+        }
+    }
+    if (std::sqrt(bestDistance) <= builder.epsilon) {
+        return hull;
+    }
+
+    Vector3 planeNormal = (builder.Point(i1) - builder.Point(i0)).Cross(builder.Point(i2) - builder.Point(i0));
+    planeNormal.Normalize();
+    unsigned int i3 = 0;
+    bestDistance = 0.0f;
+    for (unsigned int i = 0; i < pointCount; i++) {
+        const float distance = std::fabs(planeNormal.Dot(builder.Point(i) - builder.Point(i0)));
+        if (distance > bestDistance) {
+            bestDistance = distance;
+            i3 = i;
+        }
+    }
+    if (bestDistance <= builder.epsilon) {
+        return hull;
+    }
+
+    // Wind the base away from the apex, the side faces follow from it
+    if (planeNormal.Dot(builder.Point(i3) - builder.Point(i0)) > 0.0f) {
+        std::swap(i1, i2);
+    }
+    builder.AddFace(i0, i1, i2);
+    builder.AddFace(i0, i3, i1);
+    builder.AddFace(i1, i3, i2);
+    builder.AddFace(i2, i3, i0);
+
+    std::vector<unsigned int> remaining;
+    remaining.reserve(count);
+    for (unsigned int i = 0; i < pointCount; i++) {
+        if (i != i0 && i != i1 && i != i2 && i != i3) {
+            remaining.push_back(i);
+        }
+    }
+    builder.AssignPoints(remaining, 0);
+
+    // Faces are appended as the hull grows, so one pass reaches every face
+    for (size_t f = 0; f < builder.faces.size(); f++) {
+        if (builder.faces[f].alive && !builder.faces[f].outside.empty()) {
+            builder.AddPoint(builder.faces[f].outside.front());
+        }
+    }
+
+    std::vector<unsigned int> remap(count, UINT32_MAX);
+    for (const HullFace& face : builder.faces) {
+        if (!face.alive) {
+            continue;
+        }
+        for (unsigned int v : face.v) {
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = static_cast<unsigned int>(hull.vertices.size());
+                hull.vertices.push_back(builder.Point(v));
+            }
+            hull.indices.push_back(remap[v]);
+        }
+    }
+    return hull;
+}
+
+bool ConvexHull::IsEmpty() const {
+    return vertices.empty();
+}
+
+Vector3 ConvexHull::Support(const Vector3& direction) const {
+    size_t best = 0;
+    float bestDot = -FLT_MAX;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const float dot = vertices[i].Dot(direction);
+        if (dot > bestDot) {
+            bestDot = dot;
+            best = i;
+        }
+    }
+    return vertices[best];
+}
+
+ConvexShape::ConvexShape(const ConvexHull& _hull, const Matrix& _worldMatrix)
+    : hull(&_hull), worldMatrix(_worldMatrix), directionMatrix(_worldMatrix.Transpose()) {}
+
+Vector3 ConvexShape::Support(const Vector3& direction) const {
+    return Vector3::Transform(hull->Support(Vector3::TransformNormal(direction, directionMatrix)), worldMatrix);
+}
+
+namespace {
+    const int GJK_MAX_ITERATIONS = 64;
+    const int EPA_MAX_ITERATIONS = 64;
+    const float EPA_TOLERANCE = 1e-4f;
+
+    // Point of the Minkowski difference a - b, with the point of a it came from
+    struct SupportPoint {
+        Vector3 w;
+        Vector3 a;
+    };
+
+    SupportPoint GetSupport(const ConvexShape& a, const ConvexShape& b, const Vector3& direction) {
+        const Vector3 pointA = a.Support(direction);
+        return { pointA - b.Support(-direction), pointA };
+    }
+
+    // Simplex with the newest point first
+    struct Simplex {
+        SupportPoint points[4];
+        int size = 0;
+
+        void PushFront(const SupportPoint& point) {
+            for (int i = std::min(size, 3); i > 0; i--) {
+                points[i] = points[i - 1];
+            }
+            points[0] = point;
+            size = std::min(size + 1, 4);
+        }
+
+        void Set(std::initializer_list<SupportPoint> list) {
+            size = 0;
+            for (const SupportPoint& point : list) {
+                points[size++] = point;
+            }
+        }
+    };
+
+    bool SameDirection(const Vector3& direction, const Vector3& towardsOrigin) {
+        return direction.Dot(towardsOrigin) > 0.0f;
+    }
+
+    // Each case keeps the feature of the simplex closest to the origin and points the
+    // search direction at the origin from it, returns true once a tetrahedron encloses it
+    bool NextLine(Simplex& simplex, Vector3& direction) {
+        const SupportPoint a = simplex.points[0], b = simplex.points[1];
+        const Vector3 ab = b.w - a.w;
+        const Vector3 ao = -a.w;
+        if (SameDirection(ab, ao)) {
+            direction = ab.Cross(ao).Cross(ab);
+            // The origin lies on the segment, any side of it may lead into the difference
+            if (direction.LengthSquared() < FLT_EPSILON * FLT_EPSILON) {
+                direction = ab.Cross(fabsf(ab.x) < fabsf(ab.y) ? Vector3::UnitX : Vector3::UnitY);
+            }
+        } else {
+            simplex.Set({ a });
+            direction = ao;
+        }
+        return false;
+    }
+
+    bool NextTriangle(Simplex& simplex, Vector3& direction) {
+        const SupportPoint a = simplex.points[0], b = simplex.points[1], c = simplex.points[2];
+        const Vector3 ab = b.w - a.w;
+        const Vector3 ac = c.w - a.w;
+        const Vector3 ao = -a.w;
+        const Vector3 abc = ab.Cross(ac);
+        if (SameDirection(abc.Cross(ac), ao)) {
+            if (SameDirection(ac, ao)) {
+                simplex.Set({ a, c });
+                direction = ac.Cross(ao).Cross(ac);
+                return false;
+            }
+            simplex.Set({ a, b });
+            return NextLine(simplex, direction);
+        }
+        if (SameDirection(ab.Cross(abc), ao)) {
+            simplex.Set({ a, b });
+            return NextLine(simplex, direction);
+        }
+        if (SameDirection(abc, ao)) {
+            direction = abc;
+        } else {
+            simplex.Set({ a, c, b });
+            direction = -abc;
+        }
+        return false;
+    }
+
+    bool NextTetrahedron(Simplex& simplex, Vector3& direction) {
+        const SupportPoint a = simplex.points[0], b = simplex.points[1], c = simplex.points[2], d = simplex.points[3];
+        const Vector3 ab = b.w - a.w;
+        const Vector3 ac = c.w - a.w;
+        const Vector3 ad = d.w - a.w;
+        const Vector3 ao = -a.w;
+        if (SameDirection(ab.Cross(ac), ao)) {
+            simplex.Set({ a, b, c });
+            return NextTriangle(simplex, direction);
+        }
+        if (SameDirection(ac.Cross(ad), ao)) {
+            simplex.Set({ a, c, d });
+            return NextTriangle(simplex, direction);
+        }
+        if (SameDirection(ad.Cross(ab), ao)) {
+            simplex.Set({ a, d, b });
+            return NextTriangle(simplex, direction);
+        }
+        return true;
+    }
+
+    bool NextSimplex(Simplex& simplex, Vector3& direction) {
+        switch (simplex.size) {
+        case 2: return NextLine(simplex, direction);
+        case 3: return NextTriangle(simplex, direction);
+        case 4: return NextTetrahedron(simplex, direction);
+        }
+        return false;
+    }
+
+    // Leaves a tetrahedron around the origin in the simplex when the shapes overlap
+    bool RunGjk(const ConvexShape& a, const ConvexShape& b, Simplex& simplex) {
+        Vector3 direction = b.worldMatrix.Translation() - a.worldMatrix.Translation();
+        if (direction.LengthSquared() < FLT_EPSILON) {
+            direction = Vector3::UnitX;
+        }
+        simplex.Set({ GetSupport(a, b, direction) });
+        direction = -simplex.points[0].w;
+
+        for (int i = 0; i < GJK_MAX_ITERATIONS; i++) {
+            // The origin lies on the simplex, the shapes only touch
+            if (direction.LengthSquared() < FLT_EPSILON * FLT_EPSILON) {
+                return false;
+            }
+            const SupportPoint point = GetSupport(a, b, direction);
+            if (!SameDirection(point.w, direction)) {
+                return false;
+            }
+            simplex.PushFront(point);
+            if (NextSimplex(simplex, direction)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct PolytopeFace {
+        unsigned int v[3];
+        Vector3 normal;
+        float distance;
+    };
+
+    size_t FindClosestFace(const std::vector<PolytopeFace>& faces) {
+        size_t closest = 0;
+        for (size_t f = 1; f < faces.size(); f++) {
+            if (faces[f].distance < faces[closest].distance) {
+                closest = f;
+            }
+        }
+        return closest;
+    }
+
+    // Normal pointing away from the origin, false for a degenerate face
+    bool MakeFace(const std::vector<SupportPoint>& vertices, unsigned int a, unsigned int b, unsigned int c, PolytopeFace& face) {
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        face.normal = (vertices[b].w - vertices[a].w).Cross(vertices[c].w - vertices[a].w);
+        const float length = face.normal.Length();
+        if (length < FLT_EPSILON) {
+            return false;
+        }
+        face.normal *= 1.0f / length;
+        face.distance = face.normal.Dot(vertices[a].w);
+        if (face.distance < 0.0f) {
+            std::swap(face.v[1], face.v[2]);
+            face.normal = -face.normal;
+            face.distance = -face.distance;
+        }
+        return true;
+    }
+}
+
+bool Gjk::Intersect(const ConvexShape& a, const ConvexShape& b) {
+    Simplex simplex;
+    return RunGjk(a, b, simplex);
+}
+
+bool Gjk::Penetration(const ConvexShape& a, const ConvexShape& b, Vector3& normal, float& depth, Vector3& point) {
+    Simplex simplex;
+    if (!RunGjk(a, b, simplex)) {
+        return false;
+    }
+
+    // Grow the tetrahedron towards the boundary of the difference nearest the origin
+    std::vector<SupportPoint> vertices(simplex.points, simplex.points + 4);
+    std::vector<PolytopeFace> faces(4);
+    const unsigned int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+    for (int f = 0; f < 4; f++) {
+        if (!MakeFace(vertices, tetrahedron[f][0], tetrahedron[f][1], tetrahedron[f][2], faces[f])) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < EPA_MAX_ITERATIONS; i++) {
+        const PolytopeFace face = faces[FindClosestFace(faces)];
+        const SupportPoint support = GetSupport(a, b, face.normal);
+        if (face.normal.Dot(support.w) - face.distance < EPA_TOLERANCE) {
+            break;
+        }
+
+        // Remove the faces the new point sees and close the hole with faces to it
+        std::vector<std::pair<unsigned int, unsigned int>> edges;
+        for (size_t f = 0; f < faces.size();) {
+            if (!SameDirection(faces[f].normal, support.w - vertices[faces[f].v[0]].w)) {
+                f++;
+                continue;
+            }
+            for (int e = 0; e < 3; e++) {
+                const std::pair<unsigned int, unsigned int> edge(faces[f].v[e], faces[f].v[(e + 1) % 3]);
+                const auto reverse = std::find(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first));
+                if (reverse != edges.end()) {
+                    edges.erase(reverse);
+                } else {
+                    edges.push_back(edge);
+                }
+            }
+            faces[f] = faces.back();
+            faces.pop_back();
+        }
+
+        const unsigned int newIndex = static_cast<unsigned int>(vertices.size());
+        vertices.push_back(support);
+        for (const auto& edge : edges) {
+            PolytopeFace newFace;
+            if (!MakeFace(vertices, edge.first, edge.second, newIndex, newFace)) {
+                return false;
+            }
+            faces.push_back(newFace);
+        }
+        if (faces.empty()) {
+            return false;
+        }
+    }
+
+    // Without convergence the polytope changed after the last search, so search again
+    const PolytopeFace& face = faces[FindClosestFace(faces)];
+    normal = face.normal;
+    depth = face.distance;
+
+    // Barycentric coordinates of the origin's projection on the face give the matching
+    // point on a, the point on b is a whole penetration vector behind it
+    const Vector3 projection = face.normal * face.distance;
+    const Vector3& w0 = vertices[face.v[0]].w;
+    const Vector3 edge1 = vertices[face.v[1]].w - w0;
+    const Vector3 edge2 = vertices[face.v[2]].w - w0;
+    const Vector3 offset = projection - w0;
+    const float d11 = edge1.Dot(edge1), d12 = edge1.Dot(edge2), d22 = edge2.Dot(edge2);
+    const float d1 = offset.Dot(edge1), d2 = offset.Dot(edge2);
+    const float denominator = d11 * d22 - d12 * d12;
+    float v = 0.0f, w = 0.0f;
+    if (denominator > FLT_EPSILON) {
+        v = (d22 * d1 - d12 * d2) / denominator;
+        w = (d11 * d2 - d12 * d1) / denominator;
+    }
+    const Vector3 pointA = vertices[face.v[0]].a * (1.0f - v - w) + vertices[face.v[1]].a * v + vertices[face.v[2]].a * w;
+    point = pointA - 0.5f * projection;
+    return true;
+}
@@ -0,0 +1,179 @@
+#include "CullingKernels.h"
+
+#include <cstring>
+
+#ifdef CULLING_KERNELS_SSE
+#include <emmintrin.h>
+#endif
+#ifdef CULLING_KERNELS_AVX
+#include <immintrin.h>
+#endif
+
+namespace {
+    const unsigned int PLANE_COUNT = Frustum::PLANE_COUNT;
+
+    void GetPlanes(const Frustum& frustum, const Plane* planes[PLANE_COUNT]) {
+        for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+            planes[p] = &frustum.GetPlane(p);
+        }
+    }
+
+    // Same operation order as Plane::DotNormal + Plane::D, so the result matches
+    // BoundingSphere::IsOnForwardPlane exactly
+    bool IsOnFrustum(const Plane* const planes[PLANE_COUNT], float x, float y, float z, float radius) {
+        for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+            const float distance = planes[p]->x * x + planes[p]->y * y + planes[p]->z * z + planes[p]->w;
+            if (!(distance > -radius)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#ifdef CULLING_KERNELS_SSE
+    struct SSEOps {
+        using V = __m128;
+        static constexpr unsigned int WIDTH = 4;
+
+        static V Set1(float v) { return _mm_set1_ps(v); }
+        static V Load(const float* p) { return _mm_loadu_ps(p); }
+        static V Zero() { return _mm_setzero_ps(); }
+        static V AllOnes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static V Add(V a, V b) { return _mm_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V And(V a, V b) { return _mm_and_ps(a, b); }
+        static V CmpGt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+        static unsigned int MoveMask(V a) { return static_cast<unsigned int>(_mm_movemask_ps(a)); }
+    };
+#endif
+
+#ifdef CULLING_KERNELS_AVX
+    struct AVXOps {
+        using V = __m256;
+        static constexpr unsigned int WIDTH = 8;
+
+        static V Set1(float v) { return _mm256_set1_ps(v); }
+        static V Load(const float* p) { return _mm256_loadu_ps(p); }
+        static V Zero() { return _mm256_setzero_ps(); }
+        static V AllOnes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+        static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V And(V a, V b) { return _mm256_and_ps(a, b); }
+        static V CmpGt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static unsigned int MoveMask(V a) { return static_cast<unsigned int>(_mm256_movemask_ps(a)); }
+    };
+#endif
+
+#ifdef CULLING_KERNELS_SSE
+    // Returns one bit per lane, set when the sphere is in front of every plane
+    template<typename Ops>
+    unsigned int TestGroup(const typename Ops::V planes[PLANE_COUNT][4], const float* x, const float* y, const float* z, const float* radius) {
+        using V = typename Ops::V;
+
+        const V centerX = Ops::Load(x);
+        const V centerY = Ops::Load(y);
+        const V centerZ = Ops::Load(z);
+        const V negativeRadius = Ops::Sub(Ops::Zero(), Ops::Load(radius));
+
+        V visible = Ops::AllOnes();
+        for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+            V distance = Ops::Add(Ops::Mul(planes[p][0], centerX), Ops::Mul(planes[p][1], centerY));
+            distance = Ops::Add(Ops::Add(distance, Ops::Mul(planes[p][2], centerZ)), planes[p][3]);
+            visible = Ops::And(visible, Ops::CmpGt(distance, negativeRadius));
+        }
+        return Ops::MoveMask(visible);
+    }
+
+    template<typename Ops>
+    void TestRange(const Frustum& frustum, const SphereArrays& s, unsigned int count, uint32_t* visibility) {
+        const Plane* sourcePlanes[PLANE_COUNT];
+        GetPlanes(frustum, sourcePlanes);
+        typename Ops::V planes[PLANE_COUNT][4];
+        for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+            planes[p][0] = Ops::Set1(sourcePlanes[p]->x);
+            planes[p][1] = Ops::Set1(sourcePlanes[p]->y);
+            planes[p][2] = Ops::Set1(sourcePlanes[p]->z);
+            planes[p][3] = Ops::Set1(sourcePlanes[p]->w);
+        }
+
+        // WIDTH divides 32, so a group never straddles two mask words
+        unsigned int i = 0;
+        for (; i + Ops::WIDTH <= count; i += Ops::WIDTH) {
+            const unsigned int bits = TestGroup<Ops>(planes, s.centerX + i, s.centerY + i, s.centerZ + i, s.radius + i);
+            visibility[i / 32] |= bits << (i % 32);
+        }
+
+        if (i < count) {
+            // Unused lanes are padded with empty spheres at the origin and masked out
+            alignas(32) float tail[4][Ops::WIDTH] = {};
+            for (unsigned int lane = 0; lane < count - i; lane++) {
+                tail[0][lane] = s.centerX[i + lane];
+                tail[1][lane] = s.centerY[i + lane];
+                tail[2][lane] = s.centerZ[i + lane];
+                tail[3][lane] = s.radius[i + lane];
+            }
+            const unsigned int bits = TestGroup<Ops>(planes, tail[0], tail[1], tail[2], tail[3]) & ((1u << (count - i)) - 1);
+            visibility[i / 32] |= bits << (i % 32);
+        }
+    }
+#endif
+
+    void ClearMask(unsigned int count, uint32_t* visibility) {
+        memset(visibility, 0, CullingKernels::GetMaskWordCount(count) * sizeof(uint32_t));
+    }
+}
+
+unsigned int CullingKernels::GetMaskWordCount(unsigned int count) {
+    return (count + 31) / 32;
+}
+
+bool CullingKernels::IsVisible(const uint32_t* visibility, unsigned int index) {
+    return (visibility[index / 32] >> (index % 32)) & 1;
+}
+
+void CullingKernels::TestSpheresScalar(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility) {
+    ClearMask(count, visibility);
+    const Plane* planes[PLANE_COUNT];
+    GetPlanes(frustum, planes);
+    for (unsigned int i = 0; i < count; i++) {
+        if (IsOnFrustum(planes, spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i])) {
+            visibility[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+#ifdef CULLING_KERNELS_SSE
+void CullingKernels::TestSpheresSSE(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility) {
+    ClearMask(count, visibility);
+    TestRange<SSEOps>(frustum, spheres, count, visibility);
+}
+#endif
+
+#ifdef CULLING_KERNELS_AVX
+void CullingKernels::TestSpheresAVX(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility) {
+    ClearMask(count, visibility);
+    TestRange<AVXOps>(frustum, spheres, count, visibility);
+}
+#endif
+
+void CullingKernels::TestSpheres(const Frustum& frustum, const SphereArrays& spheres, unsigned int count, uint32_t* visibility) {
+#if defined(CULLING_KERNELS_AVX)
+    TestSpheresAVX(frustum, spheres, count, visibility);
+#elif defined(CULLING_KERNELS_SSE)
+    TestSpheresSSE(frustum, spheres, count, visibility);
+#else
+    TestSpheresScalar(frustum, spheres, count, visibility);
+#endif
+}
+
+const char* CullingKernels::GetInstructionSetName() {
+#if defined(CULLING_KERNELS_AVX)
+    return "AVX";
+#elif defined(CULLING_KERNELS_SSE)
+    return "SSE";
+#else
+    return "Scalar";
+#endif
+}
@@ -0,0 +1,235 @@
+#include "DynamicAabbTree.h"
+
+#include <algorithm>
+
+namespace {
+    // Proxies whose fat box grew past this many margins around the bounds are refitted
+    const float SHRINK_MARGINS = 4.0f;
+}
+
+DynamicAabbTree::DynamicAabbTree(float margin) : m_Margin(margin) {}
+
+int DynamicAabbTree::Insert(const AxisAlignedBox& bounds, void* userData) {
+    const int proxy = AllocateNode();
+    m_Nodes[proxy].bounds = bounds.Expanded(m_Margin);
+    m_Nodes[proxy].userData = userData;
+    m_Nodes[proxy].height = 0;
+    InsertLeaf(proxy);
+    m_ProxyCount++;
+    return proxy;
+}
+
+void DynamicAabbTree::Remove(int proxy) {
+    assert(proxy >= 0 && proxy < static_cast<int>(m_Nodes.size()) && m_Nodes[proxy].IsLeaf());
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    m_ProxyCount--;
+}
+
+bool DynamicAabbTree::Update(int proxy, const AxisAlignedBox& bounds) {
+    assert(proxy >= 0 && proxy < static_cast<int>(m_Nodes.size()) && m_Nodes[proxy].IsLeaf());
+    const AxisAlignedBox& fatBounds = m_Nodes[proxy].bounds;
+    if (fatBounds.Contains(bounds) && bounds.Expanded(SHRINK_MARGINS * m_Margin).Contains(fatBounds)) {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+    m_Nodes[proxy].bounds = bounds.Expanded(m_Margin);
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicAabbTree::Clear() {
+    m_Nodes.clear();
+    m_Root = NULL_PROXY;
+    m_FreeList = NULL_PROXY;
+    m_ProxyCount = 0;
+}
+
+void* DynamicAabbTree::GetUserData(int proxy) const {
+    return m_Nodes[proxy].userData;
+}
+
+const AxisAlignedBox& DynamicAabbTree::GetFatBounds(int proxy) const {
+    return m_Nodes[proxy].bounds;
+}
+
+unsigned int DynamicAabbTree::GetProxyCount() const {
+    return m_ProxyCount;
+}
+
+int DynamicAabbTree::GetHeight() const {
+    return m_Root == NULL_PROXY ? -1 : m_Nodes[m_Root].height;
+}
+
+int DynamicAabbTree::AllocateNode() {
+    if (m_FreeList == NULL_PROXY) {
+        m_Nodes.emplace_back();
+        return static_cast<int>(m_Nodes.size() - 1);
+    }
+
+    const int index = m_FreeList;
+    m_FreeList = m_Nodes[index].parent;
+    m_Nodes[index] = Node();
+    return index;
+}
+
+void DynamicAabbTree::FreeNode(int index) {
+    m_Nodes[index] = Node();
+    m_Nodes[index].parent = m_FreeList;
+    m_FreeList = index;
+}
+
+void DynamicAabbTree::InsertLeaf(int leaf) {
+    if (m_Root == NULL_PROXY) {
+        m_Root = leaf;
+        m_Nodes[leaf].parent = NULL_PROXY;
+        return;
+    }
+
+    // Descend towards the sibling that adds the least surface area, the cost of
+    // stopping at a node is the area of the new parent plus the growth of its ancestors
+    const AxisAlignedBox leafBounds = m_Nodes[leaf].bounds;
+    int index = m_Root;
+    while (!m_Nodes[index].IsLeaf()) {
+        const Node& node = m_Nodes[index];
+        const float area = node.bounds.GetSurfaceArea();
+        const float combinedArea = AxisAlignedBox::Union(node.bounds, leafBounds).GetSurfaceArea();
+        const float cost = 2.0f * combinedArea;
+        const float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            const Node& childNode = m_Nodes[child];
+            const float childCombinedArea = AxisAlignedBox::Union(childNode.bounds, leafBounds).GetSurfaceArea();
+            if (childNode.IsLeaf()) {
+                return childCombinedArea + inheritanceCost;
+            }
+            return childCombinedArea - childNode.bounds.GetSurfaceArea() + inheritanceCost;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    const int sibling = index;
+    const int oldParent = m_Nodes[sibling].parent;
+    // May grow m_Nodes, no node references are held across it
+    const int newParent = AllocateNode();
+    m_Nodes[newParent].parent = oldParent;
+    m_Nodes[newParent].bounds = AxisAlignedBox::Union(leafBounds, m_Nodes[sibling].bounds);
+    m_Nodes[newParent].height = m_Nodes[sibling].height + 1;
+    m_Nodes[newParent].child1 = sibling;
+    m_Nodes[newParent].child2 = leaf;
+    m_Nodes[sibling].parent = newParent;
+    m_Nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_PROXY) {
+        m_Root = newParent;
+    } else if (m_Nodes[oldParent].child1 == sibling) {
+        m_Nodes[oldParent].child1 = newParent;
+    } else {
+        m_Nodes[oldParent].child2 = newParent;
+    }
+
+    RefitAncestors(oldParent);
+}
+
+void DynamicAabbTree::RemoveLeaf(int leaf) {
+    if (leaf == m_Root) {
+        m_Root = NULL_PROXY;
+        return;
+    }
+
+    const int parent = m_Nodes[leaf].parent;
+    const int grandParent = m_Nodes[parent].parent;
+    const int sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+    // The sibling takes the place of the parent
+    m_Nodes[sibling].parent = grandParent;
+    if (grandParent == NULL_PROXY) {
+        m_Root = sibling;
+    } else if (m_Nodes[grandParent].child1 == parent) {
+        m_Nodes[grandParent].child1 = sibling;
+    } else {
+        m_Nodes[grandParent].child2 = sibling;
+    }
+    FreeNode(parent);
+    m_Nodes[leaf].parent = NULL_PROXY;
+
+    RefitAncestors(grandParent);
+}
+
+void DynamicAabbTree::RefitAncestors(int index) {
+    while (index != NULL_PROXY) {
+        index = Balance(index);
+
+        Node& node = m_Nodes[index];
+        const Node& child1 = m_Nodes[node.child1];
+        const Node& child2 = m_Nodes[node.child2];
+        node.bounds = AxisAlignedBox::Union(child1.bounds, child2.bounds);
+        node.height = 1 + std::max(child1.height, child2.height);
+
+        index = node.parent;
+    }
+}
+
+int DynamicAabbTree::Balance(int indexA) {
+    Node& a = m_Nodes[indexA];
+    if (a.IsLeaf() || a.height < 2) {
+        return indexA;
+    }
+
+    const int indexB = a.child1;
+    const int indexC = a.child2;
+    Node& b = m_Nodes[indexB];
+    Node& c = m_Nodes[indexC];
+    const int balance = c.height - b.height;
+    if (balance >= -1 && balance <= 1) {
+        return indexA;
+    }
+
+    // Rotate the taller child up, it takes A's place and A takes its shorter child
+    const bool rotateC = balance > 1;
+    const int indexUp = rotateC ? indexC : indexB;
+    const int indexOther = rotateC ? indexB : indexC;
+    Node& up = m_Nodes[indexUp];
+    Node& other = m_Nodes[indexOther];
+    const int indexF = up.child1;
+    const int indexG = up.child2;
+    Node& f = m_Nodes[indexF];
+    Node& g = m_Nodes[indexG];
+
+    up.child1 = indexA;
+    up.parent = a.parent;
+    a.parent = indexUp;
+    if (up.parent == NULL_PROXY) {
+        m_Root = indexUp;
+    } else if (m_Nodes[up.parent].child1 == indexA) {
+        m_Nodes[up.parent].child1 = indexUp;
+    } else {
+        m_Nodes[up.parent].child2 = indexUp;
+    }
+
+    // The taller grandchild stays under the rotated node
+    const bool keepF = f.height > g.height;
+    const int indexKept = keepF ? indexF : indexG;
+    const int indexMoved = keepF ? indexG : indexF;
+    Node& kept = m_Nodes[indexKept];
+    Node& moved = m_Nodes[indexMoved];
+    up.child2 = indexKept;
+    if (rotateC) {
+        a.child2 = indexMoved;
+    } else {
+        a.child1 = indexMoved;
+    }
+    moved.parent = indexA;
+
+    a.bounds = AxisAlignedBox::Union(other.bounds, moved.bounds);
+    a.height = 1 + std::max(other.height, moved.height);
+    up.bounds = AxisAlignedBox::Union(a.bounds, kept.bounds);
+    up.height = 1 + std::max(a.height, kept.height);
+    return indexUp;
+}
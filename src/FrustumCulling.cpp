@@ -1,15 +1,20 @@
 #include "FrustumCulling.h"
 
 #include "Camera.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <DirectXCollision.h>
 
 
 Frustum::Frustum(Camera& camera, float aspectRatio, float zNear, float zFar) {
     const float halfVertical = zFar * tanf(camera.GetFov() * 0.5f);
     const float halfHorizontal = halfVertical * aspectRatio;
 
-    Vector3 camScale, camPosition;
-    Quaternion camRot;
-    camera.transform.globalMatrix.Decompose(camScale, camRot, camPosition);
+    const Vector3 camPosition = camera.transform.GetWorldPosition();
+    const Quaternion& camRot = camera.transform.GetWorldOrientation();
     // Get camera forward direction
     Vector3 forwardCam = Vector3::Backward;
     forwardCam = Vector3::Transform(forwardCam, camRot);
@@ -37,19 +42,80 @@ Frustum::Frustum(Camera& camera, float aspectRatio, float zNear, float zFar) {
     cross = (forwardMultFar + upCam * halfVertical).Cross(rightCam);
     cross.Normalize();
     bottom = Plane(camPosition, -cross);
+
+    const float nearScale = zNear / zFar;
+    int corner = 0;
+    for (float depth : { nearScale, 1.0f }) {
+        const Vector3 center = camPosition + forwardMultFar * depth;
+        for (float vertical : { -1.0f, 1.0f }) {
+            for (float horizontal : { -1.0f, 1.0f }) {
+                corners[corner++] = center + (upCam * (vertical * halfVertical) + rightCam * (horizontal * halfHorizontal)) * depth;
+            }
+        }
+    }
+}
+
+const Plane& Frustum::GetPlane(unsigned int index) const {
+    const Plane* planes[PLANE_COUNT] = { &left, &right, &farP, &nearP, &top, &bottom };
+    return *planes[index];
+}
+
+float Frustum::GetMaxPlaneShift(const Frustum& previous) const {
+    float maxShift = 0.0f;
+    for (unsigned int p = 0; p < PLANE_COUNT; p++) {
+        const Plane& current = GetPlane(p);
+        const Plane& old = previous.GetPlane(p);
+        for (const Vector3& corner : previous.corners) {
+            const float shift = current.DotNormal(corner) + current.D() - (old.DotNormal(corner) + old.D());
+            maxShift = std::max(maxShift, fabsf(shift));
+        }
+    }
+    return maxShift;
 }
 
 BoundingSphere::BoundingSphere() : center(Vector3::Zero), radius(0.f) {}
 BoundingSphere::BoundingSphere(Vector3 _center, float _radius) : center(_center), radius(_radius) {}
 
-bool BoundingSphere::IsOnFrustum(const Frustum& camFrustum, Matrix& globalMatrix) const {
-    Vector3 scale, _pos;
-    Quaternion _quat;
-    globalMatrix.Decompose(scale, _quat, _pos);
-    Vector3 worldCenter = Vector3::Transform(center, globalMatrix);
-    const float maxScale = std::max(std::max(scale.x, scale.y), scale.z);
+BoundingSphere BoundingSphere::FromPoints(const Vector3* points, size_t count, size_t stride) {
+    if (count == 0) {
+        return BoundingSphere();
+    }
+
+    // DirectXCollision implements Ritter's algorithm on SIMD vectors
+    DirectX::BoundingSphere ritter;
+    DirectX::BoundingSphere::CreateFromPoints(ritter, count, points, stride);
+    DirectX::BoundingBox box;
+    DirectX::BoundingBox::CreateFromPoints(box, count, points, stride);
 
-    BoundingSphere worldSphere(worldCenter, radius * (maxScale * 1.0f));
+    const Vector3 boxCenter = box.Center;
+    float boxRadius = 0.0f;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(points);
+    for (size_t i = 0; i < count; i++) {
+        const Vector3& point = *reinterpret_cast<const Vector3*>(bytes + i * stride);
+        boxRadius = std::max(boxRadius, Vector3::Distance(boxCenter, point));
+    }
+
+    if (boxRadius < ritter.Radius) {
+        return BoundingSphere(boxCenter, boxRadius);
+    }
+    return BoundingSphere(ritter.Center, ritter.Radius);
+}
+
+BoundingSphere BoundingSphere::Transformed(const Transform& transform) const {
+    return BoundingSphere(Vector3::Transform(center, transform.globalMatrix), radius * transform.GetMaxWorldScale());
+}
+
+BoundingSphere BoundingSphere::Transformed(const Matrix& matrix) const {
+    const float maxScaleSquared = std::max(std::max(matrix.Right().LengthSquared(), matrix.Up().LengthSquared()), matrix.Backward().LengthSquared());
+    return BoundingSphere(Vector3::Transform(center, matrix), radius * sqrtf(maxScaleSquared));
+}
+
+bool BoundingSphere::IsOnFrustum(const Frustum& camFrustum, const Transform& transform) const {
+    return Transformed(transform).IsOnFrustum(camFrustum);
+}
+
+bool BoundingSphere::IsOnFrustum(const Frustum& camFrustum) const {
+    const BoundingSphere& worldSphere = *this;
 
    /* bool a1 = worldSphere.IsOnForwardPlane(camFrustum.left);
     bool a2 = worldSphere.IsOnForwardPlane(camFrustum.right);
@@ -69,6 +135,185 @@ bool BoundingSphere::IsOnFrustum(const Frustum& camFrustum, Matrix& globalMatrix
         worldSphere.IsOnForwardPlane(camFrustum.bottom);
 }
 
-bool BoundingSphere::IsOnForwardPlane(const Plane& camPlane) {
+bool BoundingSphere::IsOnForwardPlane(const Plane& camPlane) const {
     return (camPlane.DotNormal(center) + camPlane.D()) > -radius;
-}
\ No newline at end of file
+}
+
+bool BoundingSphere::IsOnFrustum(const Frustum& camFrustum, CullingState& state, double totalShift, unsigned int& planeTests) const {
+    if (state.inside && totalShift - state.shift < state.margin) {
+        return true;
+    }
+
+    float margin = std::numeric_limits<float>::max();
+    for (unsigned int i = 0; i < Frustum::PLANE_COUNT; i++) {
+        const unsigned int p = (state.lastRejectingPlane + i) % Frustum::PLANE_COUNT;
+        const Plane& plane = camFrustum.GetPlane(p);
+        const float distance = plane.DotNormal(center) + plane.D();
+        planeTests++;
+        if (!(distance > -radius)) {
+            state.lastRejectingPlane = static_cast<uint8_t>(p);
+            state.inside = false;
+            return false;
+        }
+        margin = std::min(margin, distance - radius);
+    }
+    state.inside = margin > 0.0f;
+    state.margin = margin;
+    state.shift = totalShift;
+    return true;
+}
+
+FrustumIntersection BoundingSphere::Classify(const Frustum& camFrustum) const {
+    FrustumIntersection result = FrustumIntersection::Inside;
+    for (const Plane* plane : { &camFrustum.left, &camFrustum.right, &camFrustum.farP,
+        &camFrustum.nearP, &camFrustum.top, &camFrustum.bottom }) {
+        const float distance = plane->DotNormal(center) + plane->D();
+        if (distance <= -radius) {
+            return FrustumIntersection::Outside;
+        }
+        if (distance < radius) {
+            result = FrustumIntersection::Intersecting;
+        }
+    }
+    return result;
+}
+
+BoundingSphere BoundingSphere::Merge(const BoundingSphere& a, const BoundingSphere& b) {
+    const Vector3 offset = b.center - a.center;
+    const float distance = offset.Length();
+    if (distance + b.radius <= a.radius) {
+        return a;
+    }
+    if (distance + a.radius <= b.radius) {
+        return b;
+    }
+    const float radius = (distance + a.radius + b.radius) * 0.5f;
+    return BoundingSphere(a.center + offset * ((radius - a.radius) / distance), radius);
+}
+
+OrientedBox::OrientedBox() : center(Vector3::Zero), halfAxes{ Vector3::Zero, Vector3::Zero, Vector3::Zero } {}
+OrientedBox::OrientedBox(Vector3 _center, Vector3 halfAxisX, Vector3 halfAxisY, Vector3 halfAxisZ)
+    : center(_center), halfAxes{ halfAxisX, halfAxisY, halfAxisZ } {}
+
+OrientedBox OrientedBox::FromPoints(const Vector3* points, size_t count, size_t stride) {
+    if (count == 0) {
+        return OrientedBox();
+    }
+
+    DirectX::BoundingBox aligned;
+    DirectX::BoundingBox::CreateFromPoints(aligned, count, points, stride);
+    const Vector3 alignedExtents = aligned.Extents;
+    const OrientedBox alignedBox(aligned.Center,
+        Vector3::UnitX * alignedExtents.x, Vector3::UnitY * alignedExtents.y, Vector3::UnitZ * alignedExtents.z);
+
+    // Principal axes of the point covariance
+    DirectX::BoundingOrientedBox oriented;
+    DirectX::BoundingOrientedBox::CreateFromPoints(oriented, count, points, stride);
+    const Matrix rotation = Matrix::CreateFromQuaternion(Quaternion(oriented.Orientation));
+    const Vector3 orientedExtents = oriented.Extents;
+    const OrientedBox orientedBox(oriented.Center,
+        Vector3::TransformNormal(Vector3::UnitX, rotation) * orientedExtents.x,
+        Vector3::TransformNormal(Vector3::UnitY, rotation) * orientedExtents.y,
+        Vector3::TransformNormal(Vector3::UnitZ, rotation) * orientedExtents.z);
+
+    return orientedBox.GetVolume() < alignedBox.GetVolume() ? orientedBox : alignedBox;
+}
+
+OrientedBox OrientedBox::Transformed(const Matrix& matrix) const {
+    return OrientedBox(Vector3::Transform(center, matrix),
+        Vector3::TransformNormal(halfAxes[0], matrix),
+        Vector3::TransformNormal(halfAxes[1], matrix),
+        Vector3::TransformNormal(halfAxes[2], matrix));
+}
+
+bool OrientedBox::IsOnFrustum(const Frustum& camFrustum) const {
+    for (unsigned int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        const Plane& plane = camFrustum.GetPlane(p);
+        const float extent = fabsf(plane.DotNormal(halfAxes[0])) + fabsf(plane.DotNormal(halfAxes[1])) + fabsf(plane.DotNormal(halfAxes[2]));
+        if (!(plane.DotNormal(center) + plane.D() > -extent)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float OrientedBox::GetVolume() const {
+    return 8.0f * fabsf(halfAxes[0].Dot(halfAxes[1].Cross(halfAxes[2])));
+}
+
+AxisAlignedBox::AxisAlignedBox() : lower(Vector3::Zero), upper(Vector3::Zero) {}
+AxisAlignedBox::AxisAlignedBox(Vector3 _lower, Vector3 _upper) : lower(_lower), upper(_upper) {}
+
+AxisAlignedBox AxisAlignedBox::FromSphere(const BoundingSphere& sphere) {
+    return AxisAlignedBox(sphere.center - Vector3(sphere.radius), sphere.center + Vector3(sphere.radius));
+}
+
+AxisAlignedBox AxisAlignedBox::FromBox(const OrientedBox& box) {
+    Vector3 extents = Vector3::Zero;
+    for (const Vector3& axis : box.halfAxes) {
+        extents += Vector3(fabsf(axis.x), fabsf(axis.y), fabsf(axis.z));
+    }
+    return AxisAlignedBox(box.center - extents, box.center + extents);
+}
+
+AxisAlignedBox AxisAlignedBox::Union(const AxisAlignedBox& a, const AxisAlignedBox& b) {
+    return AxisAlignedBox(Vector3::Min(a.lower, b.lower), Vector3::Max(a.upper, b.upper));
+}
+
+AxisAlignedBox AxisAlignedBox::Expanded(float margin) const {
+    return AxisAlignedBox(lower - Vector3(margin), upper + Vector3(margin));
+}
+
+bool AxisAlignedBox::Contains(const AxisAlignedBox& other) const {
+    return lower.x <= other.lower.x && lower.y <= other.lower.y && lower.z <= other.lower.z
+        && other.upper.x <= upper.x && other.upper.y <= upper.y && other.upper.z <= upper.z;
+}
+
+bool AxisAlignedBox::Overlaps(const AxisAlignedBox& other) const {
+    return lower.x <= other.upper.x && other.lower.x <= upper.x
+        && lower.y <= other.upper.y && other.lower.y <= upper.y
+        && lower.z <= other.upper.z && other.lower.z <= upper.z;
+}
+
+bool AxisAlignedBox::Overlaps(const BoundingSphere& sphere) const {
+    const Vector3 closest = Vector3::Max(lower, Vector3::Min(sphere.center, upper));
+    return Vector3::DistanceSquared(closest, sphere.center) <= sphere.radius * sphere.radius;
+}
+
+bool AxisAlignedBox::IntersectRay(const Vector3& origin, const Vector3& inverseDirection, float maxDistance, float& distance) const {
+    // Slab test, infinite inverse components handle rays parallel to an axis
+    const Vector3 t1 = (lower - origin) * inverseDirection;
+    const Vector3 t2 = (upper - origin) * inverseDirection;
+    const Vector3 tNear = Vector3::Min(t1, t2);
+    const Vector3 tFar = Vector3::Max(t1, t2);
+    const float entry = std::max(std::max(std::max(tNear.x, tNear.y), tNear.z), 0.0f);
+    const float exit = std::min(std::min(std::min(tFar.x, tFar.y), tFar.z), maxDistance);
+    if (entry > exit) {
+        return false;
+    }
+    distance = entry;
+    return true;
+}
+
+FrustumIntersection AxisAlignedBox::Classify(const Frustum& camFrustum) const {
+    const Vector3 center = (lower + upper) * 0.5f;
+    const Vector3 extents = (upper - lower) * 0.5f;
+    FrustumIntersection result = FrustumIntersection::Inside;
+    for (unsigned int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        const Plane& plane = camFrustum.GetPlane(p);
+        const float radius = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+        const float distance = plane.DotNormal(center) + plane.D();
+        if (!(distance > -radius)) {
+            return FrustumIntersection::Outside;
+        }
+        if (distance < radius) {
+            result = FrustumIntersection::Intersecting;
+        }
+    }
+    return result;
+}
+
+float AxisAlignedBox::GetSurfaceArea() const {
+    const Vector3 size = upper - lower;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
@@ -19,6 +19,7 @@ bool GraphicsManager::Initialize(int screenWidth, int screenHeight, HWND hWnd) {
 		return false;
 	}
 
+	m_Jobs = std::make_unique<JobSystem>(JobSystem::GetDefaultWorkerThreadCount());
 	m_Physics = std::make_unique<PhysicsManager>();
 	m_Gui = std::make_unique<GuiManager>(m_d3d->GetDevice(), m_d3d->GetDeviceContext(), m_hWnd);
 	m_Scripting = std::make_unique<ScriptingManager>();
@@ -48,9 +49,12 @@ bool GraphicsManager::Frame(float deltaTime) {
 	bool result;
 
 	ProcessInput(deltaTime);
-	m_Scene->Update(deltaTime, m_Scripting.get());
-	m_Physics->Update(m_Scene.get());
-	m_Gui->Update(m_Scene->GetSceneRoot(), m_Physics.get());
+	m_Scene->Update(deltaTime, m_Scripting.get(), m_Jobs.get(), m_Settings);
+	// Simulated poses are written to local transforms, bring their world matrices up to date
+	if (m_Physics->Update(m_Scene.get(), m_Jobs.get(), m_Settings, deltaTime)) {
+		m_Scene->UpdateTransforms(m_Jobs.get(), m_Settings);
+	}
+	m_Gui->Update(m_Scene->GetSceneRoot(), m_Physics.get(), m_Scene->GetStatistics(), m_Settings);
 	result = Render(deltaTime);
 	if (!result) {
 		return false;
@@ -74,7 +78,7 @@ bool GraphicsManager::HandleResize(int screenWidth, int screenHeight) {
 bool GraphicsManager::Render(float deltaTime) {
 	m_d3d->BeginScene(0.0f, 0.0f, 0.0f, 1.0f);
 
-	if (!m_Scene->Render()) {
+	if (!m_Scene->Render(m_Jobs.get(), m_Settings)) {
 		return false;
 	}
 	m_Gui->Render();
@@ -91,8 +95,8 @@ void GraphicsManager::ProcessInput(float deltaTime) {
 	if (!mainCamera) return;
 
 	if (kb.Home) {
-		mainCamera->transform.position = Vector3::Backward * -0.5f;
-		mainCamera->transform.rotation = Vector3::Zero;
+		mainCamera->transform.SetPosition(Vector3::Backward * -0.5f);
+		mainCamera->transform.SetRotation(Vector3::Zero);
 	}
 
 	Vector3 move = Vector3::Zero;
@@ -117,17 +121,19 @@ void GraphicsManager::ProcessInput(float deltaTime) {
 		move.y -= cameraDelta;
 	}
 
-	move = Vector3::Transform(move, Matrix::CreateFromYawPitchRoll(mainCamera->transform.rotation));
-
-	mainCamera->transform.position += move;
+	if (move != Vector3::Zero) {
+		move = Vector3::Transform(move, Matrix::CreateFromQuaternion(mainCamera->transform.GetOrientation()));
+		mainCamera->transform.SetPosition(mainCamera->transform.position + move);
+	}
 
 	auto mouse = m_Mouse->GetState();
 
 	cameraDelta = LOOK_SPEED * deltaTime;
 	if (mouse.positionMode == DirectX::Mouse::MODE_RELATIVE) {
 		Vector3 delta = Vector3(1.0f * mouse.x, 1.0f * mouse.y, 0.0f);
-		mainCamera->transform.rotation.x += delta.y * cameraDelta;
-		mainCamera->transform.rotation.y += delta.x * cameraDelta;
+		if (delta != Vector3::Zero) {
+			mainCamera->transform.SetRotation(mainCamera->transform.rotation + Vector3(delta.y, delta.x, 0.0f) * cameraDelta);
+		}
 	}
 
 	m_Mouse->SetMode(mouse.rightButton ? DirectX::Mouse::MODE_RELATIVE : DirectX::Mouse::MODE_ABSOLUTE);
@@ -0,0 +1,203 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace {
+    thread_local const JobSystem* t_OwnerSystem = nullptr;
+    thread_local unsigned int t_QueueIndex = 0;
+}
+
+bool JobCounter::IsDone() const {
+    return m_Pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(unsigned int workerThreads) {
+    for (unsigned int i = 0; i <= workerThreads; i++) {
+        m_Queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (unsigned int i = 1; i <= workerThreads; i++) {
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_Stop = true;
+    }
+    m_WakeCondition.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+unsigned int JobSystem::GetDefaultWorkerThreadCount() {
+    // Leave one hardware thread for the main loop
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter) {
+    if (counter) {
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Submit({ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> job, JobCounter* counter) {
+    if (counter) {
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        // FinishJob takes this lock after the last decrement, so a job is either
+        // stored here before the dependency completes or sees it completed
+        std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+        if (!dependency.IsDone()) {
+            dependency.m_Continuations.push_back({ std::move(job), counter });
+            return;
+        }
+    }
+    Submit({ std::move(job), counter });
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    unsigned int queueIndex = GetCurrentThreadIndex();
+    while (!counter.IsDone()) {
+        if (!TryExecuteJob(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+    // The last FinishJob still holds the lock right after the counter reaches zero
+    std::lock_guard<std::mutex> lock(counter.m_Mutex);
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int grainSize, const std::function<void(unsigned int, unsigned int)>& body) {
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max(grainSize, 1u);
+    // Same chunks without workers, callers may size per chunk state by grainSize
+    if (count <= grainSize || m_Workers.empty()) {
+        for (unsigned int begin = 0; begin < count; begin += grainSize) {
+            body(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    JobCounter counter;
+    for (unsigned int begin = 0; begin < count; begin += grainSize) {
+        unsigned int end = std::min(begin + grainSize, count);
+        Run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    Wait(counter);
+}
+
+unsigned int JobSystem::GetThreadCount() const {
+    return static_cast<unsigned int>(m_Queues.size());
+}
+
+unsigned int JobSystem::GetCurrentThreadIndex() const {
+    return t_OwnerSystem == this ? t_QueueIndex : 0;
+}
+
+void JobSystem::Submit(Job job) {
+    unsigned int queueIndex;
+    if (t_OwnerSystem == this) {
+        queueIndex = t_QueueIndex;
+    } else {
+        // Spread jobs from outside threads so idle workers find them without stealing
+        queueIndex = m_NextQueue.fetch_add(1, std::memory_order_relaxed) % GetThreadCount();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Queues[queueIndex]->mutex);
+        m_Queues[queueIndex]->jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_QueuedJobs.fetch_add(1, std::memory_order_release);
+    }
+    m_WakeCondition.notify_one();
+}
+
+bool JobSystem::TryExecuteJob(unsigned int queueIndex) {
+    Job job;
+    if (!PopJob(queueIndex, job)) {
+        return false;
+    }
+    job.function();
+    FinishJob(job.counter);
+    return true;
+}
+
+bool JobSystem::PopJob(unsigned int queueIndex, Job& job) {
+    if (m_QueuedJobs.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    // Newest job of our own queue first, it is the most likely to be in cache
+    {
+        WorkerQueue& queue = *m_Queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Otherwise steal the oldest job of another queue
+    const unsigned int queueCount = GetThreadCount();
+    for (unsigned int offset = 1; offset < queueCount; offset++) {
+        WorkerQueue& victim = *m_Queues[(queueIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::FinishJob(JobCounter* counter) {
+    if (!counter) {
+        return;
+    }
+
+    std::vector<JobCounter::Continuation> continuations;
+    {
+        // Continuations are collected under the lock so RunAfter can't miss the completion
+        std::lock_guard<std::mutex> lock(counter->m_Mutex);
+        if (counter->m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        continuations.swap(counter->m_Continuations);
+    }
+    // The counter may be destroyed by its waiter from this point on
+    for (JobCounter::Continuation& continuation : continuations) {
+        Submit({ std::move(continuation.function), continuation.counter });
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int queueIndex) {
+    t_OwnerSystem = this;
+    t_QueueIndex = queueIndex;
+
+    while (true) {
+        if (TryExecuteJob(queueIndex)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_WakeMutex);
+        m_WakeCondition.wait(lock, [this]() {
+            return m_Stop || m_QueuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (m_Stop) {
+            return;
+        }
+    }
+}
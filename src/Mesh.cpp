@@ -6,6 +6,11 @@ Mesh::Mesh(std::vector<Vertex> verts, std::vector<unsigned int> inds, Transform
     m_Vertices = verts;
     m_Indices = inds;
     this->transform = transform;
+
+    if (!m_Vertices.empty()) {
+        boundingSphere = BoundingSphere::FromPoints(&m_Vertices[0].Position, m_Vertices.size(), sizeof(Vertex));
+        boundingBox = OrientedBox::FromPoints(&m_Vertices[0].Position, m_Vertices.size(), sizeof(Vertex));
+    }
 }
 
 bool Mesh::Initialize(ID3D11Device* device) {
@@ -31,6 +36,10 @@ const std::vector<Vertex>& Mesh::GetVertices() const {
     return m_Vertices;
 }
 
+const std::vector<unsigned int>& Mesh::GetIndices() const {
+    return m_Indices;
+}
+
 bool Mesh::InitializeBuffers(ID3D11Device* device) {
     D3D11_BUFFER_DESC vertexBufferDesc;
     D3D11_BUFFER_DESC indexBufferDesc;
@@ -1,22 +1,25 @@
 #include "Model.hpp"
 
+#include <cfloat>
+
 bool Model::Initialize(std::string _name, ID3D11Device* device, const char* modelPath) {
     bool result;
     name = _name;
     m_Path = modelPath;
+    m_Lods.clear();
+    m_Lods.emplace_back();
+    m_Lods.back().path = modelPath;
     result = ImportModel(modelPath);
     if (!result) {
         return false;
     }
 
-    for (Mesh& mesh : m_Meshes) {
-        result = mesh.Initialize(device);
-        if (!result) {
-            return false;
-        }
+    result = InitializeLod(m_Lods.back(), device);
+    if (!result) {
+        return false;
     }
 
-    InitializeBoundingSphere();
+    InitializeBounds();
 
     return true;
 }
@@ -32,32 +35,74 @@ bool Model::Initialize(std::string _name, ID3D11Device* device, const char* mode
     return true;
 }
 
-void Model::InitializeBoundingSphere() {
-    Vector3 minCoords(1e9f), maxCoords(-1e9f);
-    for (const Mesh& mesh : m_Meshes) {
-        for (const Vertex& vertex : mesh.GetVertices()) {
-            minCoords = Vector3::Min(minCoords, vertex.Position);
-            maxCoords = Vector3::Max(maxCoords, vertex.Position);
+bool Model::AddLod(ID3D11Device* device, const char* modelPath, float screenSize) {
+    if (m_Lods.empty() || m_Lods.size() == MAX_LOD_COUNT) {
+        return false;
+    }
+    // SelectLod walks the levels expecting decreasing thresholds, level 0 has none
+    if (m_Lods.size() > 1 && screenSize >= m_Lods.back().screenSize) {
+        return false;
+    }
+
+    m_Lods.emplace_back();
+    m_Lods.back().path = modelPath;
+    m_Lods.back().screenSize = screenSize;
+    if (!ImportModel(modelPath) || !InitializeLod(m_Lods.back(), device)) {
+        // Meshes initialized before the failure already own their buffers
+        for (Mesh& mesh : m_Lods.back().meshes) {
+            mesh.Shutdown();
+        }
+        m_Lods.pop_back();
+        return false;
+    }
+
+    return true;
+}
+
+bool Model::InitializeLod(ModelLod& lod, ID3D11Device* device) {
+    lod.triangleCount = 0;
+    for (Mesh& mesh : lod.meshes) {
+        if (!mesh.Initialize(device)) {
+            return false;
         }
+        lod.triangleCount += mesh.GetIndexCount() / 3;
     }
-    //float radius = Vector3::Distance(maxCoords, minCoords) * 0.5f;
-    Vector3 center = (minCoords + maxCoords) * 0.5f;
-    float radius = 0.0f;
-    for (const Mesh& mesh : m_Meshes) {
+
+    return true;
+}
+
+void Model::InitializeBounds() {
+    // Meshes are drawn with their node transform applied, so bound them in model space
+    std::vector<Vector3> points;
+    std::vector<unsigned int> indices;
+    for (const Mesh& mesh : m_Lods[0].meshes) {
+        const unsigned int firstVertex = static_cast<unsigned int>(points.size());
         for (const Vertex& vertex : mesh.GetVertices()) {
-            radius = std::max(radius, Vector3::Distance(center, vertex.Position));
+            points.push_back(Vector3::Transform(vertex.Position, mesh.transform.globalMatrix));
         }
+        for (unsigned int index : mesh.GetIndices()) {
+            indices.push_back(firstVertex + index);
+        }
+    }
+    if (points.empty()) {
+        return;
     }
-    boundingSphere = BoundingSphere(center, radius);
+
+    boundingSphere = BoundingSphere::FromPoints(points.data(), points.size());
+    boundingBox = OrientedBox::FromPoints(points.data(), points.size());
+    collisionHull = ConvexHull::FromPoints(points.data(), points.size());
+    collisionMesh.Build(points, indices);
 }
 
 void Model::Shutdown() {
-    for (Mesh& mesh : m_Meshes) {
-        mesh.Shutdown();
+    for (ModelLod& lod : m_Lods) {
+        for (Mesh& mesh : lod.meshes) {
+            mesh.Shutdown();
+        }
     }
 }
 
-bool Model::Render(ID3D11DeviceContext* deviceContext, ShaderPayload* shaderPayload, Matrix worldMatrix) const {
+bool Model::Render(ID3D11DeviceContext* deviceContext, ShaderPayload* shaderPayload, Matrix worldMatrix, MeshCulling* culling, unsigned int lod) const {
     if (!m_Material) {
         return true;
     }
@@ -70,10 +115,22 @@ bool Model::Render(ID3D11DeviceContext* deviceContext, ShaderPayload* shaderPayl
         return false;
     }
 
-    for (const Mesh& mesh : m_Meshes) {
+    const std::vector<Mesh>& meshes = m_Lods[lod].meshes;
+    // A single mesh has the bounds of the model, which already passed
+    const bool cullMeshes = culling && culling->frustum && meshes.size() > 1;
+    for (const Mesh& mesh : meshes) {
+        const Matrix meshWorldMatrix = mesh.transform.globalMatrix * worldMatrix;
+        if (cullMeshes) {
+            culling->testedMeshes++;
+            if (!IsMeshVisible(mesh, meshWorldMatrix, *culling)) {
+                culling->culledMeshes++;
+                continue;
+            }
+        }
+
         // Add per mesh constant buffer data
-        shaderPayload->matrices.world = mesh.transform.globalMatrix * worldMatrix;
-        shaderPayload->lightMatrices.worldMatrix = mesh.transform.globalMatrix * worldMatrix;
+        shaderPayload->matrices.world = meshWorldMatrix;
+        shaderPayload->lightMatrices.worldMatrix = meshWorldMatrix;
         shaderPayload->lightMatrices.worldViewProjectionMatrix = shaderPayload->lightMatrices.worldMatrix 
            * shaderPayload->viewProjectionMatrix;
         shaderPayload->lightMatrices.inverseTransposeWorldMatrix =
@@ -88,15 +145,60 @@ bool Model::Render(ID3D11DeviceContext* deviceContext, ShaderPayload* shaderPayl
         }
 
         deviceContext->DrawIndexed(mesh.GetIndexCount(), 0, 0);
+        if (culling) {
+            culling->submittedTriangles += mesh.GetIndexCount() / 3;
+        }
     }
 
     return true;
 }
 
+bool Model::IsMeshVisible(const Mesh& mesh, const Matrix& meshWorldMatrix, const MeshCulling& culling) {
+    if (!mesh.boundingSphere.Transformed(meshWorldMatrix).IsOnFrustum(*culling.frustum)) {
+        return false;
+    }
+    return !culling.boxCulling || mesh.boundingBox.Transformed(meshWorldMatrix).IsOnFrustum(*culling.frustum);
+}
+
 void Model::SetMaterial(Material* material) {
     m_Material = material;
 }
 
+const std::vector<Mesh>& Model::GetMeshes(unsigned int lod) const {
+    return m_Lods[lod].meshes;
+}
+
+unsigned int Model::GetLodCount() const {
+    return static_cast<unsigned int>(m_Lods.size());
+}
+
+unsigned int Model::GetTriangleCount(unsigned int lod) const {
+    return m_Lods[lod].triangleCount;
+}
+
+unsigned int Model::SelectLod(float screenSize, unsigned int currentLod) const {
+    // Thresholds the model has to cross to reach a coarser level are lowered and the
+    // ones it has to cross back to a finer level are raised
+    unsigned int lod = 0;
+    for (unsigned int i = 1; i < m_Lods.size(); i++) {
+        const float scale = i <= currentLod ? 1.0f + LOD_HYSTERESIS : 1.0f - LOD_HYSTERESIS;
+        if (screenSize < m_Lods[i].screenSize * scale) {
+            lod = i;
+        }
+    }
+    return lod;
+}
+
+float Model::GetScreenSize(const BoundingSphere& worldBounds, const Matrix& viewMatrix, const Matrix& projectionMatrix) {
+    const float distance = Vector3::Transform(worldBounds.center, viewMatrix).Length();
+    if (distance <= worldBounds.radius) {
+        return FLT_MAX;
+    }
+    // _22 is the cotangent of half the vertical field of view, it maps a view space
+    // height at unit distance to half the screen height
+    return worldBounds.radius * projectionMatrix._22 / distance;
+}
+
 bool Model::ImportModel(const char* modelPath) {
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(modelPath, 
@@ -187,5 +289,5 @@ void Model::LoadMesh(aiMesh* mesh, const aiScene* scene, aiMatrix4x4 parentTrans
         localTransform.c1, localTransform.c2, localTransform.c3, localTransform.c4,
         localTransform.d1, localTransform.d2, localTransform.d3, localTransform.d4
     );
-    m_Meshes.push_back(Mesh(vertices, indices, Transform(pMatrix, lMatrix)));
+    m_Lods.back().meshes.push_back(Mesh(vertices, indices, Transform(pMatrix, lMatrix)));
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "Narrowphase.h"
+
+#include <cmath>
+
+#include "JobSystem.h"
+
+void Narrowphase::Run(const std::vector<CollisionBody>& bodies, const std::vector<BodyPair>& pairs, JobSystem* jobs) {
+    const unsigned int count = static_cast<unsigned int>(pairs.size());
+    const unsigned int chunkCount = jobs ? (count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE : 1;
+    m_Contacts.clear();
+    if (chunkCount <= 1) {
+        TestRange(bodies, pairs, 0, count, m_Contacts);
+        return;
+    }
+
+    if (m_ChunkContacts.size() < chunkCount) {
+        m_ChunkContacts.resize(chunkCount);
+    }
+    jobs->ParallelFor(count, PARALLEL_GRAIN_SIZE, [&](unsigned int begin, unsigned int end) {
+        std::vector<Contact>& contacts = m_ChunkContacts[begin / PARALLEL_GRAIN_SIZE];
+        contacts.clear();
+        TestRange(bodies, pairs, begin, end, contacts);
+    });
+    for (unsigned int chunk = 0; chunk < chunkCount; chunk++) {
+        m_Contacts.insert(m_Contacts.end(), m_ChunkContacts[chunk].begin(), m_ChunkContacts[chunk].end());
+    }
+}
+
+const std::vector<Contact>& Narrowphase::GetContacts() const {
+    return m_Contacts;
+}
+
+bool Narrowphase::TestSpheres(const BoundingSphere& a, const BoundingSphere& b, Contact& contact) {
+    const float radiusSum = a.radius + b.radius;
+    const Vector3 offset = b.center - a.center;
+    const float distanceSquared = offset.LengthSquared();
+    if (!(radiusSum * radiusSum > distanceSquared)) {
+        return false;
+    }
+
+    const float distance = std::sqrt(distanceSquared);
+    // Concentric spheres have no preferred direction, push them apart vertically
+    contact.normal = distance > 0.0f ? offset / distance : Vector3::UnitY;
+    contact.depth = radiusSum - distance;
+    contact.point = a.center + contact.normal * (a.radius - 0.5f * contact.depth);
+    return true;
+}
+
+bool Narrowphase::TestBodies(const CollisionBody& a, const CollisionBody& b, Contact& contact) {
+    if (!TestSpheres(a.sphere, b.sphere, contact)) {
+        return false;
+    }
+    if (a.mesh != nullptr || b.mesh != nullptr) {
+        if (a.mesh != nullptr && b.mesh != nullptr) {
+            return false;
+        }
+        if (a.mesh != nullptr) {
+            return TestMesh(a, b, contact);
+        }
+        if (!TestMesh(b, a, contact)) {
+            return false;
+        }
+        contact.normal = -contact.normal;
+        return true;
+    }
+    if (a.hull == nullptr || b.hull == nullptr || a.hull->IsEmpty() || b.hull->IsEmpty()) {
+        return true;
+    }
+
+    return Gjk::Penetration(ConvexShape(*a.hull, a.worldMatrix), ConvexShape(*b.hull, b.worldMatrix),
+        contact.normal, contact.depth, contact.point);
+}
+
+bool Narrowphase::TestSphereTriangle(const BoundingSphere& sphere, const Vector3& a, const Vector3& b, const Vector3& c, Contact& contact) {
+    // Closest point on the triangle by Voronoi region, from Ericson's Real-Time Collision Detection
+    const Vector3 ab = b - a;
+    const Vector3 ac = c - a;
+    const Vector3 ap = sphere.center - a;
+    Vector3 closest;
+    const float d1 = ab.Dot(ap), d2 = ac.Dot(ap);
+    const Vector3 bp = sphere.center - b;
+    const float d3 = ab.Dot(bp), d4 = ac.Dot(bp);
+    const Vector3 cp = sphere.center - c;
+    const float d5 = ab.Dot(cp), d6 = ac.Dot(cp);
+    const float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        closest = a;
+    } else if (d3 >= 0.0f && d4 <= d3) {
+        closest = b;
+    } else if (d6 >= 0.0f && d5 <= d6) {
+        closest = c;
+    } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        closest = a + ab * (d1 / (d1 - d3));
+    } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        closest = a + ac * (d2 / (d2 - d6));
+    } else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    } else {
+        const float denominator = 1.0f / (va + vb + vc);
+        closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    const Vector3 offset = sphere.center - closest;
+    const float distanceSquared = offset.LengthSquared();
+    if (!(sphere.radius * sphere.radius > distanceSquared)) {
+        return false;
+    }
+
+    const float distance = std::sqrt(distanceSquared);
+    if (distance > 0.0f) {
+        contact.normal = offset / distance;
+    } else {
+        // Center on the triangle, push out along the face normal
+        contact.normal = ab.Cross(ac);
+        contact.normal.Normalize();
+    }
+    contact.depth = sphere.radius - distance;
+    contact.point = closest - contact.normal * (0.5f * contact.depth);
+    return true;
+}
+
+bool Narrowphase::TestMesh(const CollisionBody& meshBody, const CollisionBody& body, Contact& contact) {
+    // The query box is the body's sphere box carried into mesh space, the triangles go
+    // the other way so the exact tests see the mesh with its scale
+    const float radius = body.sphere.radius;
+    const OrientedBox sphereBox(body.sphere.center, Vector3(radius, 0.0f, 0.0f), Vector3(0.0f, radius, 0.0f), Vector3(0.0f, 0.0f, radius));
+    const AxisAlignedBox queryBox = AxisAlignedBox::FromBox(sphereBox.Transformed(meshBody.worldMatrix.Invert()));
+
+    const bool hasHull = body.hull != nullptr && !body.hull->IsEmpty();
+    ConvexHull triangleHull;
+    if (hasHull) {
+        triangleHull.vertices.resize(3);
+    }
+    bool found = false;
+    meshBody.mesh->QueryBox(queryBox, [&](const TriangleMesh::Triangle& triangle) {
+        const Vector3 a = Vector3::Transform(triangle.a, meshBody.worldMatrix);
+        const Vector3 b = Vector3::Transform(triangle.b, meshBody.worldMatrix);
+        const Vector3 c = Vector3::Transform(triangle.c, meshBody.worldMatrix);
+        Contact triangleContact;
+        if (!TestSphereTriangle(body.sphere, a, b, c, triangleContact)) {
+            return;
+        }
+        if (hasHull) {
+            triangleHull.vertices[0] = a;
+            triangleHull.vertices[1] = b;
+            triangleHull.vertices[2] = c;
+            if (!Gjk::Penetration(ConvexShape(triangleHull, Matrix::Identity), ConvexShape(*body.hull, body.worldMatrix),
+                triangleContact.normal, triangleContact.depth, triangleContact.point)) {
+                return;
+            }
+        }
+        if (!found || triangleContact.depth > contact.depth) {
+            contact.normal = triangleContact.normal;
+            contact.point = triangleContact.point;
+            contact.depth = triangleContact.depth;
+            found = true;
+        }
+    });
+    return found;
+}
+
+void Narrowphase::TestRange(const std::vector<CollisionBody>& bodies, const std::vector<BodyPair>& pairs,
+    unsigned int begin, unsigned int end, std::vector<Contact>& contacts) {
+    Contact contact;
+    for (unsigned int i = begin; i < end; i++) {
+        const BodyPair& pair = pairs[i];
+        if (TestBodies(bodies[pair.first], bodies[pair.second], contact)) {
+            contact.first = pair.first;
+            contact.second = pair.second;
+            contacts.push_back(contact);
+        }
+    }
+}
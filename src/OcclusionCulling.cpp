@@ -0,0 +1,280 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef CULLING_KERNELS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Triangles smaller than this in pixels squared don't cover any pixel center reliably
+    const float MIN_TRIANGLE_AREA = 1e-6f;
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) {
+    width = std::max(4u, (width + 3) & ~3u);
+    height = std::max(1u, height);
+    while (true) {
+        m_Levels.push_back({ width, height, std::vector<float>(static_cast<size_t>(width) * height, 1.0f) });
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = std::max(1u, (width + 1) / 2);
+        height = std::max(1u, (height + 1) / 2);
+    }
+}
+
+void OcclusionBuffer::Clear(const Matrix& viewProjection) {
+    m_ViewProjection = viewProjection;
+    m_RasterizedTriangles = 0;
+    for (Level& level : m_Levels) {
+        std::fill(level.depth.begin(), level.depth.end(), 1.0f);
+    }
+}
+
+OcclusionBuffer::ClipVertex OcclusionBuffer::ToClipSpace(const Vector3& p, const Matrix& m) {
+    return {
+        p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+        p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+        p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43,
+        p.x * m._14 + p.y * m._24 + p.z * m._34 + m._44
+    };
+}
+
+void OcclusionBuffer::RasterizeTriangles(const Vector3* positions, size_t vertexCount, size_t stride,
+    const unsigned int* indices, size_t indexCount, const Matrix& worldMatrix) {
+    const Matrix worldViewProjection = worldMatrix * m_ViewProjection;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(positions);
+    m_ClipVertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        m_ClipVertices[i] = ToClipSpace(*reinterpret_cast<const Vector3*>(bytes + i * stride), worldViewProjection);
+    }
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const ClipVertex& a = m_ClipVertices[indices[i]];
+        const ClipVertex& b = m_ClipVertices[indices[i + 1]];
+        const ClipVertex& c = m_ClipVertices[indices[i + 2]];
+
+        // Entirely outside one of the clip planes
+        if ((a.x < -a.w && b.x < -b.w && c.x < -c.w) || (a.x > a.w && b.x > b.w && c.x > c.w) ||
+            (a.y < -a.w && b.y < -b.w && c.y < -c.w) || (a.y > a.w && b.y > b.w && c.y > c.w) ||
+            (a.z < 0.0f && b.z < 0.0f && c.z < 0.0f) || (a.z > a.w && b.z > b.w && c.z > c.w)) {
+            continue;
+        }
+        RasterizeClipped(a, b, c);
+    }
+}
+
+void OcclusionBuffer::RasterizeClipped(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+    if (a.z >= 0.0f && b.z >= 0.0f && c.z >= 0.0f) {
+        RasterizeTriangle(a, b, c);
+        return;
+    }
+
+    // Sutherland-Hodgman against z >= 0, a triangle becomes at most a quad
+    const ClipVertex input[3] = { a, b, c };
+    ClipVertex output[4];
+    unsigned int outputCount = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+        const ClipVertex& current = input[i];
+        const ClipVertex& next = input[(i + 1) % 3];
+        if (current.z >= 0.0f) {
+            output[outputCount++] = current;
+        }
+        if ((current.z >= 0.0f) != (next.z >= 0.0f)) {
+            const float t = current.z / (current.z - next.z);
+            output[outputCount++] = {
+                current.x + (next.x - current.x) * t,
+                current.y + (next.y - current.y) * t,
+                0.0f,
+                current.w + (next.w - current.w) * t
+            };
+        }
+    }
+    for (unsigned int i = 2; i < outputCount; i++) {
+        RasterizeTriangle(output[0], output[i - 1], output[i]);
+    }
+}
+
+void OcclusionBuffer::RasterizeTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+    Level& target = m_Levels[0];
+    const float width = static_cast<float>(target.width);
+    const float height = static_cast<float>(target.height);
+
+    // Screen space, pixel (x, y) covers [x, x + 1) x [y, y + 1) and is sampled at its center
+    struct ScreenVertex {
+        float x, y, z;
+    };
+    auto toScreen = [&](const ClipVertex& v) {
+        const float invW = 1.0f / v.w;
+        return ScreenVertex{ (v.x * invW * 0.5f + 0.5f) * width, (0.5f - v.y * invW * 0.5f) * height, v.z * invW };
+    };
+    ScreenVertex v0 = toScreen(a);
+    ScreenVertex v1 = toScreen(b);
+    ScreenVertex v2 = toScreen(c);
+
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (fabsf(area) < MIN_TRIANGLE_AREA) {
+        return;
+    }
+    // Occluders are double sided
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    const int minX = std::max(0, static_cast<int>(floorf(std::min(std::min(v0.x, v1.x), v2.x))));
+    const int maxX = std::min(static_cast<int>(target.width) - 1, static_cast<int>(ceilf(std::max(std::max(v0.x, v1.x), v2.x))));
+    const int minY = std::max(0, static_cast<int>(floorf(std::min(std::min(v0.y, v1.y), v2.y))));
+    const int maxY = std::min(static_cast<int>(target.height) - 1, static_cast<int>(ceilf(std::max(std::max(v0.y, v1.y), v2.y))));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+    m_RasterizedTriangles++;
+
+    // Edge functions are positive inside, e12 is the barycentric weight of v0 times the area
+    const float e12X = -(v2.y - v1.y), e12Y = v2.x - v1.x, e12C = -(e12X * v1.x + e12Y * v1.y);
+    const float e20X = -(v0.y - v2.y), e20Y = v0.x - v2.x, e20C = -(e20X * v2.x + e20Y * v2.y);
+    const float e01X = -(v1.y - v0.y), e01Y = v1.x - v0.x, e01C = -(e01X * v0.x + e01Y * v0.y);
+    // Depth is affine in screen space
+    const float invArea = 1.0f / area;
+    const float depthX = (e12X * v0.z + e20X * v1.z + e01X * v2.z) * invArea;
+    const float depthY = (e12Y * v0.z + e20Y * v1.z + e01Y * v2.z) * invArea;
+    float depthC = (e12C * v0.z + e20C * v1.z + e01C * v2.z) * invArea;
+
+    // Coverage is sampled at pixel centers like the GPU does, so triangles sharing an edge
+    // leave no cracks. The depth written is the farthest one of the plane over the pixel.
+    depthC += 0.5f * (fabsf(depthX) + fabsf(depthY));
+
+#ifdef CULLING_KERNELS_SSE
+    // Groups of 4 pixels aligned to the row start, the width is a multiple of 4
+    const int groupMinX = minX & ~3;
+    const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (int y = minY; y <= maxY; y++) {
+        const float centerY = y + 0.5f;
+        float* row = target.depth.data() + static_cast<size_t>(y) * target.width;
+        for (int x = groupMinX; x <= maxX; x += 4) {
+            const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+            const __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e12X), centerX), _mm_set1_ps(e12Y * centerY + e12C));
+            const __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e20X), centerX), _mm_set1_ps(e20Y * centerY + e20C));
+            const __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e01X), centerX), _mm_set1_ps(e01Y * centerY + e01C));
+            const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+
+            const __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthX), centerX), _mm_set1_ps(depthY * centerY + depthC));
+            const __m128 previous = _mm_loadu_ps(row + x);
+            const __m128 nearest = _mm_min_ps(previous, depth);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        const float centerY = y + 0.5f;
+        float* row = target.depth.data() + static_cast<size_t>(y) * target.width;
+        for (int x = minX; x <= maxX; x++) {
+            const float centerX = x + 0.5f;
+            const float w0 = e12X * centerX + (e12Y * centerY + e12C);
+            const float w1 = e20X * centerX + (e20Y * centerY + e20C);
+            const float w2 = e01X * centerX + (e01Y * centerY + e01C);
+            if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+                row[x] = std::min(row[x], depthX * centerX + (depthY * centerY + depthC));
+            }
+        }
+    }
+#endif
+}
+
+void OcclusionBuffer::BuildHierarchy() {
+    for (size_t l = 1; l < m_Levels.size(); l++) {
+        const Level& source = m_Levels[l - 1];
+        Level& target = m_Levels[l];
+        for (unsigned int y = 0; y < target.height; y++) {
+            const unsigned int y0 = std::min(2 * y, source.height - 1);
+            const unsigned int y1 = std::min(2 * y + 1, source.height - 1);
+            for (unsigned int x = 0; x < target.width; x++) {
+                const unsigned int x0 = std::min(2 * x, source.width - 1);
+                const unsigned int x1 = std::min(2 * x + 1, source.width - 1);
+                target.depth[y * target.width + x] = std::max(
+                    std::max(source.depth[y0 * source.width + x0], source.depth[y0 * source.width + x1]),
+                    std::max(source.depth[y1 * source.width + x0], source.depth[y1 * source.width + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const OrientedBox& worldBox) const {
+    const Level& base = m_Levels[0];
+    float minX = std::numeric_limits<float>::max(), maxX = -std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+    float minDepth = std::numeric_limits<float>::max();
+    for (unsigned int corner = 0; corner < 8; corner++) {
+        const Vector3 position = worldBox.center
+            + worldBox.halfAxes[0] * ((corner & 1) ? 1.0f : -1.0f)
+            + worldBox.halfAxes[1] * ((corner & 2) ? 1.0f : -1.0f)
+            + worldBox.halfAxes[2] * ((corner & 4) ? 1.0f : -1.0f);
+        const ClipVertex v = ToClipSpace(position, m_ViewProjection);
+        // Crossing the near plane, the box contains the camera or is right next to it
+        if (v.z < 0.0f) {
+            return true;
+        }
+        const float invW = 1.0f / v.w;
+        const float x = (v.x * invW * 0.5f + 0.5f) * base.width;
+        const float y = (0.5f - v.y * invW * 0.5f) * base.height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minDepth = std::min(minDepth, v.z * invW);
+    }
+
+    const int x0 = std::max(0, static_cast<int>(floorf(minX)));
+    const int x1 = std::min(static_cast<int>(base.width) - 1, static_cast<int>(floorf(maxX)));
+    const int y0 = std::max(0, static_cast<int>(floorf(minY)));
+    const int y1 = std::min(static_cast<int>(base.height) - 1, static_cast<int>(floorf(maxY)));
+    if (x0 > x1 || y0 > y1) {
+        // Off screen, frustum culling decides about these
+        return true;
+    }
+
+    // Finest level where the rectangle spans at most 4x4 texels, a 2x2 footprint would
+    // often reach a texel dominated by the background next to the occluder
+    unsigned int level = 0;
+    while (((x1 >> level) - (x0 >> level)) > 3 || ((y1 >> level) - (y0 >> level)) > 3) {
+        level++;
+    }
+    const Level& hiZ = m_Levels[std::min<size_t>(level, m_Levels.size() - 1)];
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (minDepth <= hiZ.depth[y * hiZ.width + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+unsigned int OcclusionBuffer::GetWidth() const {
+    return m_Levels[0].width;
+}
+
+unsigned int OcclusionBuffer::GetHeight() const {
+    return m_Levels[0].height;
+}
+
+unsigned int OcclusionBuffer::GetLevelCount() const {
+    return static_cast<unsigned int>(m_Levels.size());
+}
+
+float OcclusionBuffer::GetDepth(unsigned int level, unsigned int x, unsigned int y) const {
+    const Level& source = m_Levels[level];
+    return source.depth[y * source.width + x];
+}
+
+unsigned int OcclusionBuffer::GetRasterizedTriangleCount() const {
+    return m_RasterizedTriangles;
+}
@@ -0,0 +1,119 @@
+#include "PairCache.h"
+
+#include <algorithm>
+
+uint64_t FlatPairSet::MakeKey(unsigned int a, unsigned int b) {
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+ContactPair FlatPairSet::GetPair(uint64_t key) {
+    return { static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key) };
+}
+
+void FlatPairSet::Clear() {
+    // Latest first, so the keys a probe sequence runs over are still in place
+    for (auto key = m_Keys.rbegin(); key != m_Keys.rend(); ++key) {
+        m_Slots[FindSlot(*key)] = EMPTY_KEY;
+    }
+    m_Keys.clear();
+}
+
+bool FlatPairSet::Insert(uint64_t key) {
+    // At most half full, probe sequences stay short
+    if (2 * (m_Keys.size() + 1) > m_Slots.size()) {
+        Grow();
+    }
+    const size_t slot = FindSlot(key);
+    if (m_Slots[slot] == key) {
+        return false;
+    }
+    m_Slots[slot] = key;
+    m_SlotIndices[slot] = static_cast<unsigned int>(m_Keys.size());
+    m_Keys.push_back(key);
+    return true;
+}
+
+bool FlatPairSet::Contains(uint64_t key) const {
+    return !m_Slots.empty() && m_Slots[FindSlot(key)] == key;
+}
+
+unsigned int FlatPairSet::Find(uint64_t key) const {
+    if (m_Slots.empty()) {
+        return NOT_FOUND;
+    }
+    const size_t slot = FindSlot(key);
+    return m_Slots[slot] == key ? m_SlotIndices[slot] : NOT_FOUND;
+}
+
+const std::vector<uint64_t>& FlatPairSet::GetKeys() const {
+    return m_Keys;
+}
+
+size_t FlatPairSet::FindSlot(uint64_t key) const {
+    // Fibonacci hashing, the multiplication mixes both ids into the top bits
+    const size_t mask = m_Slots.size() - 1;
+    size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> m_Shift);
+    while (m_Slots[slot] != key && m_Slots[slot] != EMPTY_KEY) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void FlatPairSet::Grow() {
+    const size_t slotCount = std::max<size_t>(64, 2 * m_Slots.size());
+    m_Slots.assign(slotCount, EMPTY_KEY);
+    m_SlotIndices.resize(slotCount);
+    m_Shift = 64;
+    for (size_t count = slotCount; count > 1; count /= 2) {
+        m_Shift--;
+    }
+    for (size_t i = 0; i < m_Keys.size(); i++) {
+        const size_t slot = FindSlot(m_Keys[i]);
+        m_Slots[slot] = m_Keys[i];
+        m_SlotIndices[slot] = static_cast<unsigned int>(i);
+    }
+}
+
+void PairCache::BeginFrame() {
+    std::swap(m_Previous, m_Current);
+    m_Current.Clear();
+    m_BeginContacts.clear();
+    m_PersistContacts.clear();
+    m_EndContacts.clear();
+}
+
+void PairCache::Add(unsigned int a, unsigned int b) {
+    const uint64_t key = FlatPairSet::MakeKey(a, b);
+    if (!m_Current.Insert(key)) {
+        return;
+    }
+    if (m_Previous.Contains(key)) {
+        m_PersistContacts.push_back(FlatPairSet::GetPair(key));
+    } else {
+        m_BeginContacts.push_back(FlatPairSet::GetPair(key));
+    }
+}
+
+void PairCache::EndFrame() {
+    for (uint64_t key : m_Previous.GetKeys()) {
+        if (!m_Current.Contains(key)) {
+            m_EndContacts.push_back(FlatPairSet::GetPair(key));
+        }
+    }
+}
+
+const std::vector<ContactPair>& PairCache::GetBeginContacts() const {
+    return m_BeginContacts;
+}
+
+const std::vector<ContactPair>& PairCache::GetPersistContacts() const {
+    return m_PersistContacts;
+}
+
+const std::vector<ContactPair>& PairCache::GetEndContacts() const {
+    return m_EndContacts;
+}
+
+unsigned int PairCache::GetContactCount() const {
+    return static_cast<unsigned int>(m_Current.GetKeys().size());
+}
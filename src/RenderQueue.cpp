@@ -0,0 +1,154 @@
+#include "RenderQueue.h"
+
+#include <cassert>
+
+#include "SceneNode.h"
+#include "JobSystem.h"
+
+void RenderQueue::Clear() {
+    m_Nodes.clear();
+    m_CandidateOffsets.clear();
+    m_CenterX.clear();
+    m_CenterY.clear();
+    m_CenterZ.clear();
+    m_Radius.clear();
+    m_Visible.clear();
+}
+
+void RenderQueue::AddVisible(SceneNode* node) {
+    m_Nodes.push_back(node);
+    m_CandidateOffsets.push_back(GetCandidateCount());
+}
+
+void RenderQueue::AddCandidate(SceneNode* node, const BoundingSphere& worldBounds) {
+    m_Nodes.push_back(node);
+    m_CandidateOffsets.push_back(GetCandidateCount());
+    m_CenterX.push_back(worldBounds.center.x);
+    m_CenterY.push_back(worldBounds.center.y);
+    m_CenterZ.push_back(worldBounds.center.z);
+    m_Radius.push_back(worldBounds.radius);
+}
+
+void RenderQueue::Cull(const Frustum& frustum, JobSystem* jobs, bool temporalCoherence, bool boxCulling) {
+    // Tracked in both modes, so the culling states stay valid when switching. States
+    // are only ever written by this queue, none can exist before the first frustum.
+    if (m_PreviousFrustum) {
+        m_TotalShift += frustum.GetMaxPlaneShift(*m_PreviousFrustum);
+    }
+    m_PreviousFrustum = frustum;
+
+    const unsigned int count = GetCount();
+    m_CandidateOffsets.resize(count);
+    m_CandidateOffsets.push_back(GetCandidateCount());
+
+    const unsigned int chunkCount = jobs ? (count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE : 1;
+    if (m_Chunks.size() < chunkCount) {
+        m_Chunks.resize(chunkCount);
+    }
+    if (chunkCount > 1) {
+        jobs->ParallelFor(count, PARALLEL_GRAIN_SIZE, [&](unsigned int begin, unsigned int end) {
+            CullRange(frustum, begin, end, temporalCoherence, boxCulling, m_Chunks[begin / PARALLEL_GRAIN_SIZE]);
+        });
+    } else {
+        CullRange(frustum, 0, count, temporalCoherence, boxCulling, m_Chunks[0]);
+    }
+
+    m_Visible.clear();
+    m_PlaneTests = 0;
+    m_BoxCulled = 0;
+    for (unsigned int chunk = 0; chunk < chunkCount; chunk++) {
+        m_Visible.insert(m_Visible.end(), m_Chunks[chunk].visible.begin(), m_Chunks[chunk].visible.end());
+        m_PlaneTests += m_Chunks[chunk].planeTests;
+        m_BoxCulled += m_Chunks[chunk].boxCulled;
+    }
+}
+
+void RenderQueue::CullRange(const Frustum& frustum, unsigned int begin, unsigned int end, bool temporalCoherence, bool boxCulling, ChunkBuffer& buffer) {
+    const unsigned int candidateBegin = m_CandidateOffsets[begin];
+    const unsigned int candidateCount = m_CandidateOffsets[end] - candidateBegin;
+    const SphereArrays spheres = {
+        m_CenterX.data() + candidateBegin, m_CenterY.data() + candidateBegin,
+        m_CenterZ.data() + candidateBegin, m_Radius.data() + candidateBegin
+    };
+
+    buffer.visible.clear();
+    buffer.planeTests = 0;
+    buffer.boxCulled = 0;
+    if (temporalCoherence) {
+        for (unsigned int i = begin; i < end; i++) {
+            const unsigned int candidate = m_CandidateOffsets[i] - candidateBegin;
+            if (m_CandidateOffsets[i + 1] == m_CandidateOffsets[i]) {
+                buffer.visible.push_back(m_Nodes[i]);
+                continue;
+            }
+
+            BoundingSphere sphere(Vector3(spheres.centerX[candidate], spheres.centerY[candidate], spheres.centerZ[candidate]), spheres.radius[candidate]);
+            if (!sphere.IsOnFrustum(frustum, m_Nodes[i]->cullingState, m_TotalShift, buffer.planeTests)) {
+                continue;
+            }
+            // A sphere fully inside the frustum can't be rejected by the box either
+            if (!boxCulling || m_Nodes[i]->cullingState.inside || TestBox(frustum, m_Nodes[i], buffer)) {
+                m_Nodes[i]->culled = false;
+                buffer.visible.push_back(m_Nodes[i]);
+            }
+        }
+        return;
+    }
+
+    buffer.visibility.resize(CullingKernels::GetMaskWordCount(candidateCount));
+    CullingKernels::TestSpheres(frustum, spheres, candidateCount, buffer.visibility.data());
+    buffer.planeTests = candidateCount * Frustum::PLANE_COUNT;
+
+    for (unsigned int i = begin; i < end; i++) {
+        const unsigned int candidate = m_CandidateOffsets[i] - candidateBegin;
+        const bool isCandidate = m_CandidateOffsets[i + 1] != m_CandidateOffsets[i];
+        if (!isCandidate) {
+            buffer.visible.push_back(m_Nodes[i]);
+            continue;
+        }
+
+        const bool visible = CullingKernels::IsVisible(buffer.visibility.data(), candidate);
+#ifdef _DEBUG
+        BoundingSphere sphere(Vector3(spheres.centerX[candidate], spheres.centerY[candidate], spheres.centerZ[candidate]), spheres.radius[candidate]);
+        assert(visible == sphere.IsOnFrustum(frustum));
+#endif
+        if (visible && (!boxCulling || TestBox(frustum, m_Nodes[i], buffer))) {
+            // Every node belongs to a single chunk, the flag is the only per-node write
+            m_Nodes[i]->culled = false;
+            buffer.visible.push_back(m_Nodes[i]);
+        }
+    }
+}
+
+bool RenderQueue::TestBox(const Frustum& frustum, const SceneNode* node, ChunkBuffer& buffer) {
+    buffer.planeTests += Frustum::PLANE_COUNT;
+    if (node->GetWorldBox().IsOnFrustum(frustum)) {
+        return true;
+    }
+    buffer.boxCulled++;
+    return false;
+}
+
+unsigned int RenderQueue::GetCount() const {
+    return static_cast<unsigned int>(m_Nodes.size());
+}
+
+unsigned int RenderQueue::GetCandidateCount() const {
+    return static_cast<unsigned int>(m_Radius.size());
+}
+
+unsigned int RenderQueue::GetVisibleCount() const {
+    return static_cast<unsigned int>(m_Visible.size());
+}
+
+SceneNode* RenderQueue::GetVisibleNode(unsigned int index) const {
+    return m_Visible[index];
+}
+
+unsigned int RenderQueue::GetPlaneTestCount() const {
+    return m_PlaneTests;
+}
+
+unsigned int RenderQueue::GetBoxCulledCount() const {
+    return m_BoxCulled;
+}
@@ -0,0 +1,764 @@
+#include "RigidBodyWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "JobSystem.h"
+
+namespace {
+    // Penetration left to the position correction, so resting contacts don't jitter
+    const float PENETRATION_SLOP = 0.01f;
+    // Fraction of the remaining penetration removed per step
+    const float BAUMGARTE_FACTOR = 0.2f;
+    // Manifold points whose bodies separated or slid this far apart are dropped
+    const float CONTACT_BREAKING_DISTANCE = 0.02f;
+    // A new point this close to an old one replaces it and inherits its impulses
+    const float CONTACT_MERGE_DISTANCE = 0.02f;
+    // Manifolds whose normal turned further than this (cosine) start over
+    const float NORMAL_COHERENCE = 0.95f;
+    // Tilt of a hull body that brings one of its edges or corners into contact, in radians
+    const float PERTURBATION_ANGLE = 0.05f;
+    // Bodies slower than this, linear and angular, for this many seconds may sleep
+    const float SLEEP_LINEAR_VELOCITY = 0.1f;
+    const float SLEEP_ANGULAR_VELOCITY = 0.1f;
+    const float TIME_TO_SLEEP = 0.5f;
+    // Islands per job, most are a handful of bodies
+    const unsigned int ISLAND_GRAIN_SIZE = 16;
+    // Manifolds topped up per job, each is up to four narrowphase tests
+    const unsigned int TOP_UP_GRAIN_SIZE = 64;
+    // Relative scale changes below this are rounding in the world matrix, not edits
+    const float SCALE_TOLERANCE = 1e-4f;
+
+    Vector3 ToBodyFrame(const Vector3& point, const Vector3& position, const Quaternion& orientation) {
+        Quaternion inverse = orientation;
+        inverse.Conjugate();
+        return Vector3::Transform(point - position, inverse);
+    }
+
+    Vector3 ToWorld(const Vector3& point, const Vector3& position, const Quaternion& orientation) {
+        return position + Vector3::Transform(point, orientation);
+    }
+
+    // Any unit vector perpendicular to the normal
+    Vector3 GetTangent(const Vector3& normal) {
+        Vector3 tangent = std::fabs(normal.x) > 0.57735f ? Vector3(normal.y, -normal.x, 0.0f) : Vector3(0.0f, normal.z, -normal.y);
+        tangent.Normalize();
+        return tangent;
+    }
+
+    // Solid box of the scaled extents, with a floor on them so flat models can still turn
+    Vector3 GetBoxInverseInertia(float mass, const Vector3& extents) {
+        const Vector3 clamped = Vector3::Max(extents, Vector3(0.01f));
+        const Vector3 squared = clamped * clamped;
+        const float factor = mass / 3.0f;
+        return Vector3(1.0f / (factor * (squared.y + squared.z)), 1.0f / (factor * (squared.x + squared.z)),
+            1.0f / (factor * (squared.x + squared.y)));
+    }
+
+    // Twice the area of the quadrilateral, as the largest cross product of its diagonals
+    float GetQuadArea(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d) {
+        return std::max({ (a - b).Cross(c - d).LengthSquared(), (a - c).Cross(b - d).LengthSquared(), (a - d).Cross(b - c).LengthSquared() });
+    }
+}
+
+unsigned int RigidBodyWorld::AddBody(const RigidBodyDesc& desc, const Vector3& position, const Quaternion& orientation) {
+    const unsigned int body = static_cast<unsigned int>(m_Positions.size());
+    m_Positions.push_back(position);
+    m_Orientations.push_back(orientation);
+    m_PreviousPositions.push_back(position);
+    m_PreviousOrientations.push_back(orientation);
+    m_LinearVelocities.push_back(Vector3::Zero);
+    m_AngularVelocities.push_back(Vector3::Zero);
+
+    float inverseMass = 0.0f;
+    Vector3 inverseInertia = Vector3::Zero;
+    if (desc.mass > 0.0f) {
+        inverseMass = 1.0f / desc.mass;
+        inverseInertia = GetBoxInverseInertia(desc.mass, desc.localExtents * desc.scale);
+    }
+    m_InverseMasses.push_back(inverseMass);
+    m_InverseInertias.push_back(inverseInertia);
+    m_LocalExtents.push_back(desc.localExtents);
+
+    m_LocalSpheres.push_back(desc.localSphere);
+    m_Scales.push_back(desc.scale);
+    m_Hulls.push_back(desc.hull);
+    m_Meshes.push_back(desc.mesh);
+    m_Filters.push_back(desc.filter);
+
+    m_SleepingIslandIds.push_back(NO_ISLAND);
+    m_SleepTimes.push_back(0.0f);
+    // New static bodies are tested against sleeping ones once
+    m_Moved.push_back(1);
+    return body;
+}
+
+void RigidBodyWorld::Clear() {
+    m_Positions.clear();
+    m_Orientations.clear();
+    m_PreviousPositions.clear();
+    m_PreviousOrientations.clear();
+    m_LinearVelocities.clear();
+    m_AngularVelocities.clear();
+    m_InverseMasses.clear();
+    m_InverseInertias.clear();
+    m_LocalExtents.clear();
+    m_LocalSpheres.clear();
+    m_Scales.clear();
+    m_Hulls.clear();
+    m_Meshes.clear();
+    m_Filters.clear();
+    m_SleepingIslandIds.clear();
+    m_SleepTimes.clear();
+    m_Moved.clear();
+    m_SleepingIslands.clear();
+    m_Manifolds.clear();
+    m_ManifoldKeys.Clear();
+    m_PreviousManifoldKeys.Clear();
+    m_SleepingContacts.clear();
+    m_Islands.clear();
+}
+
+void RigidBodyWorld::SetPose(unsigned int body, const Vector3& position, const Quaternion& orientation) {
+    if (!IsStatic(body)) {
+        WakeBody(body);
+    } else if (position != m_Positions[body] || orientation != m_Orientations[body]) {
+        m_Moved[body] = 1;
+    }
+    m_Positions[body] = position;
+    m_Orientations[body] = orientation;
+    m_PreviousPositions[body] = position;
+    m_PreviousOrientations[body] = orientation;
+}
+
+void RigidBodyWorld::SetScale(unsigned int body, const Vector3& scale) {
+    const Vector3 change = scale - m_Scales[body];
+    const float tolerance = SCALE_TOLERANCE * std::max(m_Scales[body].Length(), scale.Length());
+    if (change.LengthSquared() <= tolerance * tolerance) {
+        return;
+    }
+    m_Scales[body] = scale;
+    if (IsStatic(body)) {
+        m_Moved[body] = 1;
+    } else {
+        m_InverseInertias[body] = GetBoxInverseInertia(1.0f / m_InverseMasses[body], m_LocalExtents[body] * scale);
+        WakeBody(body);
+    }
+}
+
+void RigidBodyWorld::SetVelocity(unsigned int body, const Vector3& linearVelocity, const Vector3& angularVelocity) {
+    WakeBody(body);
+    m_LinearVelocities[body] = linearVelocity;
+    m_AngularVelocities[body] = angularVelocity;
+}
+
+void RigidBodyWorld::WakeBody(unsigned int body) {
+    if (!IsSleeping(body)) {
+        return;
+    }
+    const auto island = m_SleepingIslands.find(m_SleepingIslandIds[body]);
+    if (island == m_SleepingIslands.end()) {
+        return;
+    }
+    for (unsigned int sleeper : island->second) {
+        m_SleepingIslandIds[sleeper] = NO_ISLAND;
+        m_SleepTimes[sleeper] = 0.0f;
+    }
+    m_SleepingIslands.erase(island);
+}
+
+void RigidBodyWorld::WakeAll() {
+    for (const auto& island : m_SleepingIslands) {
+        for (unsigned int sleeper : island.second) {
+            m_SleepingIslandIds[sleeper] = NO_ISLAND;
+            m_SleepTimes[sleeper] = 0.0f;
+        }
+    }
+    m_SleepingIslands.clear();
+}
+
+void RigidBodyWorld::DetectCollisions(const EngineSettings& settings, JobSystem* jobs) {
+    FindContacts(settings, jobs, false);
+}
+
+void RigidBodyWorld::FindContacts(const EngineSettings& settings, JobSystem* jobs, bool skipResting) {
+    UpdateCollisionBodies();
+    m_Pairs.clear();
+    Broadphase* broadphase = &m_SweepAndPrune;
+    if (settings.spatialHashBroadphase) {
+        m_SpatialHashGrid.SetCellSize(settings.gridCellSize);
+        broadphase = &m_SpatialHashGrid;
+    }
+    broadphase->FindPairs(m_Bounds, m_Filters, m_Pairs);
+
+    // Static pairs are still tested for the contact events
+    m_TestedPairs.clear();
+    for (const BodyPair& pair : m_Pairs) {
+        const bool staticPair = IsStatic(pair.first) && IsStatic(pair.second);
+        if (!skipResting || staticPair || m_Active[pair.first] || m_Active[pair.second]) {
+            m_TestedPairs.push_back(pair);
+        }
+    }
+    m_Narrowphase.Run(m_CollisionBodies, m_TestedPairs, settings.parallelNarrowphase ? jobs : nullptr);
+}
+
+void RigidBodyWorld::Step(float timestep, const EngineSettings& settings, JobSystem* jobs) {
+    if (!settings.sleeping) {
+        WakeAll();
+    }
+
+    const unsigned int count = GetBodyCount();
+    m_Active.resize(count);
+    for (unsigned int body = 0; body < count; body++) {
+        const bool awake = !IsStatic(body) && !IsSleeping(body);
+        m_Active[body] = awake || m_Moved[body];
+        if (awake) {
+            m_PreviousPositions[body] = m_Positions[body];
+            m_PreviousOrientations[body] = m_Orientations[body];
+            m_LinearVelocities[body] += gravity * timestep;
+        }
+    }
+
+    FindContacts(settings, jobs, true);
+    std::fill(m_Moved.begin(), m_Moved.end(), 0);
+    UpdateManifolds(settings.parallelNarrowphase ? jobs : nullptr);
+    BuildIslands();
+
+    const unsigned int islandCount = static_cast<unsigned int>(m_Islands.size());
+    if (jobs != nullptr && settings.parallelIslands && islandCount > ISLAND_GRAIN_SIZE) {
+        jobs->ParallelFor(islandCount, ISLAND_GRAIN_SIZE, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int island = begin; island < end; island++) {
+                SolveIsland(m_Islands[island], timestep, settings);
+            }
+        });
+    } else {
+        for (Island& island : m_Islands) {
+            SolveIsland(island, timestep, settings);
+        }
+    }
+
+    if (settings.sleeping) {
+        SleepIslands();
+    }
+}
+
+unsigned int RigidBodyWorld::GetBodyCount() const {
+    return static_cast<unsigned int>(m_Positions.size());
+}
+
+bool RigidBodyWorld::IsStatic(unsigned int body) const {
+    return m_InverseMasses[body] == 0.0f;
+}
+
+bool RigidBodyWorld::IsSleeping(unsigned int body) const {
+    return m_SleepingIslandIds[body] != NO_ISLAND;
+}
+
+const Vector3& RigidBodyWorld::GetPosition(unsigned int body) const {
+    return m_Positions[body];
+}
+
+const Quaternion& RigidBodyWorld::GetOrientation(unsigned int body) const {
+    return m_Orientations[body];
+}
+
+const Vector3& RigidBodyWorld::GetLinearVelocity(unsigned int body) const {
+    return m_LinearVelocities[body];
+}
+
+const Vector3& RigidBodyWorld::GetAngularVelocity(unsigned int body) const {
+    return m_AngularVelocities[body];
+}
+
+Vector3 RigidBodyWorld::GetInterpolatedPosition(unsigned int body, float alpha) const {
+    return Vector3::Lerp(m_PreviousPositions[body], m_Positions[body], alpha);
+}
+
+Quaternion RigidBodyWorld::GetInterpolatedOrientation(unsigned int body, float alpha) const {
+    return Quaternion::Slerp(m_PreviousOrientations[body], m_Orientations[body], alpha);
+}
+
+const Narrowphase& RigidBodyWorld::GetNarrowphase() const {
+    return m_Narrowphase;
+}
+
+const std::vector<BodyPair>& RigidBodyWorld::GetSleepingContacts() const {
+    return m_SleepingContacts;
+}
+
+unsigned int RigidBodyWorld::GetIslandCount() const {
+    return static_cast<unsigned int>(m_Islands.size());
+}
+
+unsigned int RigidBodyWorld::GetAwakeBodyCount() const {
+    return static_cast<unsigned int>(m_IslandBodies.size());
+}
+
+unsigned int RigidBodyWorld::GetManifoldPointCount() const {
+    unsigned int points = 0;
+    for (const Manifold& manifold : m_Manifolds) {
+        points += manifold.pointCount;
+    }
+    return points;
+}
+
+void RigidBodyWorld::UpdateCollisionBodies() {
+    const unsigned int count = GetBodyCount();
+    m_CollisionBodies.resize(count);
+    m_Bounds.resize(count);
+    m_WorldInverseInertias.resize(count);
+    for (unsigned int body = 0; body < count; body++) {
+        // Sleeping bodies haven't moved since they fell asleep
+        if (IsSleeping(body)) {
+            continue;
+        }
+        const Matrix rotation = Matrix::CreateFromQuaternion(m_Orientations[body]);
+        Matrix worldMatrix = Matrix::CreateScale(m_Scales[body]) * rotation;
+        worldMatrix.Translation(m_Positions[body]);
+        const Vector3& scale = m_Scales[body];
+        const BoundingSphere sphere(Vector3::Transform(m_LocalSpheres[body].center, worldMatrix),
+            m_LocalSpheres[body].radius * std::max({ scale.x, scale.y, scale.z }));
+
+        m_CollisionBodies[body] = { sphere, m_Hulls[body], worldMatrix, m_Meshes[body] };
+        m_Bounds[body] = AxisAlignedBox::FromSphere(sphere);
+        // Into the body frame, scaled by the diagonal and back
+        m_WorldInverseInertias[body] = rotation.Transpose() * Matrix::CreateScale(m_InverseInertias[body]) * rotation;
+    }
+}
+
+void RigidBodyWorld::UpdateManifolds(JobSystem* jobs) {
+    std::swap(m_Manifolds, m_PreviousManifolds);
+    m_Manifolds.clear();
+    m_TopUpManifolds.clear();
+    std::swap(m_ManifoldKeys, m_PreviousManifoldKeys);
+    m_ManifoldKeys.Clear();
+
+    for (const Contact& contact : m_Narrowphase.GetContacts()) {
+        const unsigned int a = contact.first;
+        const unsigned int b = contact.second;
+        if (IsStatic(a) && IsStatic(b)) {
+            continue;
+        }
+        // Only pairs with an awake or moved body were tested, a sleeping one is disturbed
+        WakeBody(a);
+        WakeBody(b);
+
+        Manifold manifold;
+        manifold.bodyA = a;
+        manifold.bodyB = b;
+        manifold.normal = contact.normal;
+        manifold.pointCount = 0;
+
+        // Old points still touching along the new normal keep their impulses
+        const uint64_t key = FlatPairSet::MakeKey(a, b);
+        const unsigned int previous = m_PreviousManifoldKeys.Find(key);
+        if (previous != FlatPairSet::NOT_FOUND) {
+            const Manifold& old = m_PreviousManifolds[previous];
+            if (old.normal.Dot(contact.normal) > NORMAL_COHERENCE) {
+                for (unsigned int i = 0; i < old.pointCount; i++) {
+                    ManifoldPoint point = old.points[i];
+                    const Vector3 pointA = ToWorld(point.localA, m_Positions[a], m_Orientations[a]);
+                    const Vector3 pointB = ToWorld(point.localB, m_Positions[b], m_Orientations[b]);
+                    const Vector3 separation = pointA - pointB;
+                    point.depth = separation.Dot(contact.normal);
+                    const Vector3 drift = separation - contact.normal * point.depth;
+                    if (point.depth > -CONTACT_BREAKING_DISTANCE && drift.LengthSquared() < CONTACT_BREAKING_DISTANCE * CONTACT_BREAKING_DISTANCE) {
+                        manifold.points[manifold.pointCount++] = point;
+                    }
+                }
+            }
+        }
+
+        // The deepest points of both bodies, half the depth on either side of the contact point
+        ManifoldPoint point;
+        point.localA = ToBodyFrame(contact.point + contact.normal * (0.5f * contact.depth), m_Positions[a], m_Orientations[a]);
+        point.localB = ToBodyFrame(contact.point - contact.normal * (0.5f * contact.depth), m_Positions[b], m_Orientations[b]);
+        point.depth = contact.depth;
+        point.normalImpulse = 0.0f;
+        point.tangentImpulses[0] = 0.0f;
+        point.tangentImpulses[1] = 0.0f;
+        AddManifoldPoint(manifold, point);
+        if (manifold.pointCount < MAX_MANIFOLD_POINTS) {
+            m_TopUpManifolds.push_back(static_cast<unsigned int>(m_Manifolds.size()));
+        }
+
+        m_ManifoldKeys.Insert(key);
+        m_Manifolds.push_back(manifold);
+    }
+
+    // Each top up only writes its own manifold, so they run like the narrowphase
+    const unsigned int topUpCount = static_cast<unsigned int>(m_TopUpManifolds.size());
+    auto topUp = [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            AddPerturbedPoints(m_Manifolds[m_TopUpManifolds[i]]);
+        }
+    };
+    if (jobs != nullptr && topUpCount > TOP_UP_GRAIN_SIZE) {
+        jobs->ParallelFor(topUpCount, TOP_UP_GRAIN_SIZE, topUp);
+    } else {
+        topUp(0, topUpCount);
+    }
+
+    // Untested pairs had no active body, their bodies haven't moved and the contact holds.
+    // A tested pair that lost its contact had its support moved away, so a sleeping body
+    // of it wakes up and falls.
+    m_SleepingContacts.clear();
+    for (const Manifold& manifold : m_PreviousManifolds) {
+        const uint64_t key = FlatPairSet::MakeKey(manifold.bodyA, manifold.bodyB);
+        if (m_ManifoldKeys.Contains(key)) {
+            continue;
+        }
+        if (m_Active[manifold.bodyA] || m_Active[manifold.bodyB]) {
+            WakeBody(manifold.bodyA);
+            WakeBody(manifold.bodyB);
+        } else {
+            m_ManifoldKeys.Insert(key);
+            m_Manifolds.push_back(manifold);
+            m_SleepingContacts.push_back({ manifold.bodyA, manifold.bodyB });
+        }
+    }
+}
+
+void RigidBodyWorld::AddPerturbedPoints(Manifold& manifold) const {
+    // The narrowphase finds one point per step, in the middle of a face contact. Tilting
+    // the dynamic body a little each way around the normal makes the corners of the
+    // face deepest in turn, so a resting box gets its full manifold in one step.
+    const unsigned int a = manifold.bodyA;
+    const unsigned int b = manifold.bodyB;
+    const bool tiltA = !IsStatic(a);
+    const unsigned int tilted = tiltA ? a : b;
+    const CollisionBody& body = m_CollisionBodies[tilted];
+    if (body.hull == nullptr || body.hull->IsEmpty()) {
+        return;
+    }
+
+    const Vector3& center = m_Positions[tilted];
+    // Diagonals of the tangent plane, so boxes lined up with it dip a corner and not an edge
+    const Vector3 tangent = GetTangent(manifold.normal);
+    const Vector3 bitangent = manifold.normal.Cross(tangent);
+    const Vector3 axes[4] = { tangent + bitangent, tangent - bitangent, bitangent - tangent, -tangent - bitangent };
+    for (const Vector3& axis : axes) {
+        const Matrix toCenter = Matrix::CreateTranslation(-center);
+        const Matrix fromCenter = Matrix::CreateTranslation(center);
+        CollisionBody perturbed = body;
+        const Vector3 unitAxis = axis * 0.70710678f;
+        perturbed.worldMatrix = body.worldMatrix * toCenter * Matrix::CreateFromAxisAngle(unitAxis, PERTURBATION_ANGLE) * fromCenter;
+        Contact contact;
+        if (!(tiltA ? Narrowphase::TestBodies(perturbed, m_CollisionBodies[b], contact) : Narrowphase::TestBodies(m_CollisionBodies[a], perturbed, contact))) {
+            continue;
+        }
+
+        // The point on the tilted body turns back with it, the other one is its projection
+        // along the normal, so the pair stays lined up like the points of a real contact
+        const Matrix restore = toCenter * Matrix::CreateFromAxisAngle(unitAxis, -PERTURBATION_ANGLE) * fromCenter;
+        Vector3 pointA = contact.point + contact.normal * (0.5f * contact.depth);
+        Vector3 pointB = contact.point - contact.normal * (0.5f * contact.depth);
+        float depth = 0.0f;
+        if (tiltA) {
+            pointA = Vector3::Transform(pointA, restore);
+            depth = (pointA - pointB).Dot(manifold.normal);
+            pointB = pointA - manifold.normal * depth;
+        } else {
+            pointB = Vector3::Transform(pointB, restore);
+            depth = (pointA - pointB).Dot(manifold.normal);
+            pointA = pointB + manifold.normal * depth;
+        }
+
+        ManifoldPoint point;
+        point.localA = ToBodyFrame(pointA, m_Positions[a], m_Orientations[a]);
+        point.localB = ToBodyFrame(pointB, m_Positions[b], m_Orientations[b]);
+        point.depth = depth;
+        point.normalImpulse = 0.0f;
+        point.tangentImpulses[0] = 0.0f;
+        point.tangentImpulses[1] = 0.0f;
+        if (point.depth > -CONTACT_BREAKING_DISTANCE) {
+            AddManifoldPoint(manifold, point);
+        }
+    }
+}
+
+void RigidBodyWorld::AddManifoldPoint(Manifold& manifold, const ManifoldPoint& point) const {
+    const Vector3 pointA = ToWorld(point.localA, m_Positions[manifold.bodyA], m_Orientations[manifold.bodyA]);
+    Vector3 oldPoints[MAX_MANIFOLD_POINTS];
+    for (unsigned int i = 0; i < manifold.pointCount; i++) {
+        oldPoints[i] = ToWorld(manifold.points[i].localA, m_Positions[manifold.bodyA], m_Orientations[manifold.bodyA]);
+        if (Vector3::DistanceSquared(oldPoints[i], pointA) < CONTACT_MERGE_DISTANCE * CONTACT_MERGE_DISTANCE) {
+            ManifoldPoint merged = point;
+            merged.normalImpulse = manifold.points[i].normalImpulse;
+            merged.tangentImpulses[0] = manifold.points[i].tangentImpulses[0];
+            merged.tangentImpulses[1] = manifold.points[i].tangentImpulses[1];
+            manifold.points[i] = merged;
+            return;
+        }
+    }
+    if (manifold.pointCount < MAX_MANIFOLD_POINTS) {
+        manifold.points[manifold.pointCount++] = point;
+        return;
+    }
+
+    // Full, the new point replaces the old one whose loss leaves the largest area
+    unsigned int replaced = 0;
+    float bestArea = -1.0f;
+    for (unsigned int i = 0; i < MAX_MANIFOLD_POINTS; i++) {
+        Vector3 kept[MAX_MANIFOLD_POINTS];
+        for (unsigned int j = 0; j < MAX_MANIFOLD_POINTS; j++) {
+            kept[j] = j == i ? pointA : oldPoints[j];
+        }
+        const float area = GetQuadArea(kept[0], kept[1], kept[2], kept[3]);
+        if (area > bestArea) {
+            bestArea = area;
+            replaced = i;
+        }
+    }
+    manifold.points[replaced] = point;
+}
+
+float RigidBodyWorld::GetEffectiveMass(unsigned int bodyA, unsigned int bodyB, const Vector3& offsetA, const Vector3& offsetB,
+    const Vector3& direction) const {
+    const Vector3 angularA = Vector3::TransformNormal(offsetA.Cross(direction), m_WorldInverseInertias[bodyA]).Cross(offsetA);
+    const Vector3 angularB = Vector3::TransformNormal(offsetB.Cross(direction), m_WorldInverseInertias[bodyB]).Cross(offsetB);
+    const float inverse = m_InverseMasses[bodyA] + m_InverseMasses[bodyB] + direction.Dot(angularA + angularB);
+    return inverse > 0.0f ? 1.0f / inverse : 0.0f;
+}
+
+void RigidBodyWorld::ApplyImpulse(unsigned int bodyA, unsigned int bodyB, const Vector3& offsetA, const Vector3& offsetB, const Vector3& impulse) {
+    // Static bodies are shared by the islands solved in parallel, so they are never written
+    if (!IsStatic(bodyA)) {
+        m_LinearVelocities[bodyA] -= impulse * m_InverseMasses[bodyA];
+        m_AngularVelocities[bodyA] -= Vector3::TransformNormal(offsetA.Cross(impulse), m_WorldInverseInertias[bodyA]);
+    }
+    if (!IsStatic(bodyB)) {
+        m_LinearVelocities[bodyB] += impulse * m_InverseMasses[bodyB];
+        m_AngularVelocities[bodyB] += Vector3::TransformNormal(offsetB.Cross(impulse), m_WorldInverseInertias[bodyB]);
+    }
+}
+
+void RigidBodyWorld::BuildIslands() {
+    // A sleeping body can only touch its own island, but a manifold kept from the last
+    // step may join one that was just woken to one that wasn't yet
+    for (const Manifold& manifold : m_Manifolds) {
+        if (!IsStatic(manifold.bodyA) && !IsStatic(manifold.bodyB) && IsSleeping(manifold.bodyA) != IsSleeping(manifold.bodyB)) {
+            WakeBody(manifold.bodyA);
+            WakeBody(manifold.bodyB);
+        }
+    }
+
+    // Union-find over the awake dynamic bodies, static bodies don't join islands
+    const unsigned int count = GetBodyCount();
+    m_IslandParents.resize(count);
+    for (unsigned int body = 0; body < count; body++) {
+        m_IslandParents[body] = body;
+    }
+    for (const Manifold& manifold : m_Manifolds) {
+        const unsigned int a = manifold.bodyA;
+        const unsigned int b = manifold.bodyB;
+        if (IsStatic(a) || IsStatic(b) || IsSleeping(a)) {
+            continue;
+        }
+        const unsigned int rootA = FindRoot(a);
+        const unsigned int rootB = FindRoot(b);
+        m_IslandParents[std::max(rootA, rootB)] = std::min(rootA, rootB);
+    }
+
+    // Islands are numbered in the order of their first body, so the result doesn't
+    // depend on the manifold order. Counts first, the runs are laid out after.
+    m_Islands.clear();
+    m_IslandIndices.assign(count, NO_ISLAND);
+    for (unsigned int body = 0; body < count; body++) {
+        if (IsStatic(body) || IsSleeping(body)) {
+            continue;
+        }
+        const unsigned int root = FindRoot(body);
+        if (m_IslandIndices[root] == NO_ISLAND) {
+            m_IslandIndices[root] = static_cast<unsigned int>(m_Islands.size());
+            m_Islands.push_back({ 0, 0, 0, 0, 0, 0, false });
+        }
+        m_IslandIndices[body] = m_IslandIndices[root];
+        m_Islands[m_IslandIndices[body]].bodyCount++;
+    }
+    // Manifolds go to the island of their dynamic body, the ones kept for sleeping
+    // islands to none
+    std::vector<unsigned int> manifoldIslands(m_Manifolds.size(), NO_ISLAND);
+    std::vector<unsigned int> pointCounts(m_Islands.size(), 0);
+    for (unsigned int i = 0; i < m_Manifolds.size(); i++) {
+        const unsigned int a = m_Manifolds[i].bodyA;
+        const unsigned int island = m_IslandIndices[IsStatic(a) ? m_Manifolds[i].bodyB : a];
+        if (island != NO_ISLAND) {
+            manifoldIslands[i] = island;
+            m_Islands[island].manifoldCount++;
+            pointCounts[island] += m_Manifolds[i].pointCount;
+        }
+    }
+
+    unsigned int bodyBegin = 0;
+    unsigned int manifoldBegin = 0;
+    unsigned int constraintBegin = 0;
+    for (unsigned int i = 0; i < m_Islands.size(); i++) {
+        Island& island = m_Islands[i];
+        island.bodyBegin = bodyBegin;
+        island.manifoldBegin = manifoldBegin;
+        island.constraintBegin = constraintBegin;
+        island.constraintCount = pointCounts[i];
+        bodyBegin += island.bodyCount;
+        manifoldBegin += island.manifoldCount;
+        constraintBegin += pointCounts[i];
+        // Counted again while the runs are filled
+        island.bodyCount = 0;
+        island.manifoldCount = 0;
+    }
+    m_IslandBodies.resize(bodyBegin);
+    m_IslandManifolds.resize(manifoldBegin);
+    m_Constraints.resize(constraintBegin);
+    for (unsigned int body = 0; body < count; body++) {
+        if (m_IslandIndices[body] != NO_ISLAND) {
+            Island& island = m_Islands[m_IslandIndices[body]];
+            m_IslandBodies[island.bodyBegin + island.bodyCount++] = body;
+        }
+    }
+    for (unsigned int i = 0; i < m_Manifolds.size(); i++) {
+        if (manifoldIslands[i] != NO_ISLAND) {
+            Island& island = m_Islands[manifoldIslands[i]];
+            m_IslandManifolds[island.manifoldBegin + island.manifoldCount++] = i;
+        }
+    }
+}
+
+unsigned int RigidBodyWorld::FindRoot(unsigned int body) {
+    // Path halving, every other node on the way points to its grandparent
+    while (m_IslandParents[body] != body) {
+        m_IslandParents[body] = m_IslandParents[m_IslandParents[body]];
+        body = m_IslandParents[body];
+    }
+    return body;
+}
+
+void RigidBodyWorld::SolveIsland(Island& island, float timestep, const EngineSettings& settings) {
+    PrepareConstraints(island, timestep, settings.warmStarting);
+    for (int i = 0; i < settings.solverIterations; i++) {
+        SolveConstraints(island);
+    }
+    StoreImpulses(island);
+    IntegratePositions(island, timestep);
+
+    island.resting = true;
+    for (unsigned int i = island.bodyBegin; i < island.bodyBegin + island.bodyCount; i++) {
+        const unsigned int body = m_IslandBodies[i];
+        const bool slow = m_LinearVelocities[body].LengthSquared() < SLEEP_LINEAR_VELOCITY * SLEEP_LINEAR_VELOCITY
+            && m_AngularVelocities[body].LengthSquared() < SLEEP_ANGULAR_VELOCITY * SLEEP_ANGULAR_VELOCITY;
+        m_SleepTimes[body] = slow ? m_SleepTimes[body] + timestep : 0.0f;
+        island.resting = island.resting && m_SleepTimes[body] >= TIME_TO_SLEEP;
+    }
+}
+
+void RigidBodyWorld::PrepareConstraints(const Island& island, float timestep, bool warmStarting) {
+    unsigned int index = island.constraintBegin;
+    for (unsigned int m = island.manifoldBegin; m < island.manifoldBegin + island.manifoldCount; m++) {
+        const Manifold& manifold = m_Manifolds[m_IslandManifolds[m]];
+        const unsigned int a = manifold.bodyA;
+        const unsigned int b = manifold.bodyB;
+        for (unsigned int i = 0; i < manifold.pointCount; i++) {
+            const ManifoldPoint& point = manifold.points[i];
+            // Midway between the deepest points of the two bodies
+            const Vector3 contactPoint = 0.5f * (ToWorld(point.localA, m_Positions[a], m_Orientations[a])
+                + ToWorld(point.localB, m_Positions[b], m_Orientations[b]));
+
+            ContactConstraint& constraint = m_Constraints[index++];
+            constraint.bodyA = a;
+            constraint.bodyB = b;
+            constraint.normal = manifold.normal;
+            constraint.tangents[0] = GetTangent(manifold.normal);
+            constraint.tangents[1] = manifold.normal.Cross(constraint.tangents[0]);
+            constraint.offsetA = contactPoint - m_Positions[a];
+            constraint.offsetB = contactPoint - m_Positions[b];
+            constraint.normalMass = GetEffectiveMass(a, b, constraint.offsetA, constraint.offsetB, constraint.normal);
+            for (int t = 0; t < 2; t++) {
+                constraint.tangentMasses[t] = GetEffectiveMass(a, b, constraint.offsetA, constraint.offsetB, constraint.tangents[t]);
+            }
+            // Points still apart let the bodies approach until they touch
+            constraint.bias = point.depth < 0.0f ? point.depth / timestep
+                : BAUMGARTE_FACTOR / timestep * std::max(point.depth - PENETRATION_SLOP, 0.0f);
+            constraint.normalImpulse = warmStarting ? point.normalImpulse : 0.0f;
+            constraint.tangentImpulses[0] = warmStarting ? point.tangentImpulses[0] : 0.0f;
+            constraint.tangentImpulses[1] = warmStarting ? point.tangentImpulses[1] : 0.0f;
+
+            ApplyImpulse(a, b, constraint.offsetA, constraint.offsetB, constraint.normal * constraint.normalImpulse
+                + constraint.tangents[0] * constraint.tangentImpulses[0] + constraint.tangents[1] * constraint.tangentImpulses[1]);
+        }
+    }
+}
+
+void RigidBodyWorld::SolveConstraints(const Island& island) {
+    for (unsigned int i = island.constraintBegin; i < island.constraintBegin + island.constraintCount; i++) {
+        ContactConstraint& constraint = m_Constraints[i];
+        const unsigned int a = constraint.bodyA;
+        const unsigned int b = constraint.bodyB;
+
+        // Friction first, bounded by the normal impulse of the last iteration
+        for (int t = 0; t < 2; t++) {
+            const Vector3 relativeVelocity = m_LinearVelocities[b] + m_AngularVelocities[b].Cross(constraint.offsetB)
+                - m_LinearVelocities[a] - m_AngularVelocities[a].Cross(constraint.offsetA);
+            const float limit = friction * constraint.normalImpulse;
+            const float impulse = -constraint.tangentMasses[t] * relativeVelocity.Dot(constraint.tangents[t]);
+            const float previous = constraint.tangentImpulses[t];
+            constraint.tangentImpulses[t] = std::max(-limit, std::min(previous + impulse, limit));
+            ApplyImpulse(a, b, constraint.offsetA, constraint.offsetB, constraint.tangents[t] * (constraint.tangentImpulses[t] - previous));
+        }
+
+        // The accumulated normal impulse may only push
+        const Vector3 relativeVelocity = m_LinearVelocities[b] + m_AngularVelocities[b].Cross(constraint.offsetB)
+            - m_LinearVelocities[a] - m_AngularVelocities[a].Cross(constraint.offsetA);
+        const float impulse = -constraint.normalMass * (relativeVelocity.Dot(constraint.normal) - constraint.bias);
+        const float previous = constraint.normalImpulse;
+        constraint.normalImpulse = std::max(previous + impulse, 0.0f);
+        ApplyImpulse(a, b, constraint.offsetA, constraint.offsetB, constraint.normal * (constraint.normalImpulse - previous));
+    }
+}
+
+void RigidBodyWorld::StoreImpulses(const Island& island) {
+    // Constraints were created in manifold and point order
+    unsigned int index = island.constraintBegin;
+    for (unsigned int m = island.manifoldBegin; m < island.manifoldBegin + island.manifoldCount; m++) {
+        Manifold& manifold = m_Manifolds[m_IslandManifolds[m]];
+        for (unsigned int i = 0; i < manifold.pointCount; i++) {
+            const ContactConstraint& constraint = m_Constraints[index++];
+            manifold.points[i].normalImpulse = constraint.normalImpulse;
+            manifold.points[i].tangentImpulses[0] = constraint.tangentImpulses[0];
+            manifold.points[i].tangentImpulses[1] = constraint.tangentImpulses[1];
+        }
+    }
+}
+
+void RigidBodyWorld::IntegratePositions(const Island& island, float timestep) {
+    for (unsigned int i = island.bodyBegin; i < island.bodyBegin + island.bodyCount; i++) {
+        const unsigned int body = m_IslandBodies[i];
+        m_Positions[body] += m_LinearVelocities[body] * timestep;
+
+        // dq/dt = 0.5 * w * q with w the angular velocity as a pure quaternion
+        const Vector3& angularVelocity = m_AngularVelocities[body];
+        Quaternion& orientation = m_Orientations[body];
+        const Quaternion spin = orientation * Quaternion(angularVelocity.x, angularVelocity.y, angularVelocity.z, 0.0f);
+        const float halfStep = 0.5f * timestep;
+        orientation = Quaternion(orientation.x + spin.x * halfStep, orientation.y + spin.y * halfStep,
+            orientation.z + spin.z * halfStep, orientation.w + spin.w * halfStep);
+        orientation.Normalize();
+    }
+}
+
+void RigidBodyWorld::SleepIslands() {
+    for (const Island& island : m_Islands) {
+        if (!island.resting) {
+            continue;
+        }
+        const unsigned int id = m_NextSleepingIslandId++;
+        std::vector<unsigned int>& sleepers = m_SleepingIslands[id];
+        for (unsigned int i = island.bodyBegin; i < island.bodyBegin + island.bodyCount; i++) {
+            const unsigned int body = m_IslandBodies[i];
+            m_SleepingIslandIds[body] = id;
+            m_LinearVelocities[body] = Vector3::Zero;
+            m_AngularVelocities[body] = Vector3::Zero;
+            m_PreviousPositions[body] = m_Positions[body];
+            m_PreviousOrientations[body] = m_Orientations[body];
+            sleepers.push_back(body);
+        }
+    }
+}
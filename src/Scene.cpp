@@ -18,6 +18,9 @@ bool Scene::Initialize(int screenWidth, int screenHeight, HWND hWnd) {
 	m_ScreenHeight = screenHeight;
 	Deserializer deser;
 	deser.DeserializeScene(this, "scenes/scene4.json");
+	m_TransformHierarchy.Build(m_SceneRoot.get());
+	// Bounds are refreshed by the first transform update, every node is dirty until then
+	InsertIntoSpatialTree(m_SceneRoot.get());
 	m_MainCamera->GenerateProjectionMatrices(screenWidth, screenHeight, SCREEN_DEPTH, SCREEN_NEAR);
 
 	/*if (!InitializeShaders()) {
@@ -144,16 +147,16 @@ void Scene::InitializeScene(int screenWidth, int screenHeight) {
 	m_MainCamera = camera.get();
 
 	// Change initial data here
-	m_MainCamera->transform.position = Vector3(0.0f, 0.0f, -5.0f);
+	m_MainCamera->transform.SetPosition(Vector3(0.0f, 0.0f, -5.0f));
 
 	m_SceneRoot = std::make_unique<SceneNode>("root");
 
 	std::unique_ptr<SceneNode> node1 = std::make_unique<SceneNode>("teapot", m_SceneRoot.get(), m_Models["Teapot"].get());
 	std::unique_ptr<SceneNode> node2 = std::make_unique<SceneNode>("car", node1.get(), m_Models["Car"].get());
-	node2->transform.position = Vector3(25.0f, 0.0f, -4.0f);
+	node2->transform.SetPosition(Vector3(25.0f, 0.0f, -4.0f));
 	//node2->transform.UpdateGlobalMatrix();
 	std::unique_ptr<SceneNode> node3 = std::make_unique<SceneNode>("teapot2", node2.get(), m_Models["Teapot"].get());
-	node3->transform.position = Vector3(30.0f, 0.0f, 0.0f);
+	node3->transform.SetPosition(Vector3(30.0f, 0.0f, 0.0f));
 	node2->AddChild(std::move(node3));
 	node1->AddChild(std::move(node2));
 
@@ -172,14 +175,14 @@ void Scene::InitializeScene(int screenWidth, int screenHeight) {
 	light = std::make_unique<Light>("static light", 
 		DirectX::Colors::LightBlue.v, Vector3(1.0f, 0.2f, 0.1f),
 		true, m_SceneRoot.get(), m_Models["Sphere"].get());
-	light->transform.position = Vector3(-2.0f, 4.0f, -1.0f);
-	light->transform.scale = Vector3(0.3f);
+	light->transform.SetPosition(Vector3(-2.0f, 4.0f, -1.0f));
+	light->transform.SetScale(Vector3(0.3f));
 	m_Lights.insert({ light->name, light.get() });
 
 	m_SceneRoot->AddChild(std::move(light));
 
 	std::unique_ptr<SceneNode> ground = std::make_unique<SceneNode>("ground",m_SceneRoot.get(), m_Models["Plane"].get());
-	ground->transform.scale *= Vector3(50.0f, 1.0f, 50.0f);
+	ground->transform.SetScale(ground->transform.scale * Vector3(50.0f, 1.0f, 50.0f));
 	m_SceneRoot->AddChild(std::move(ground));
 
 	//camera->SetModel(m_Models[0].get());
@@ -203,22 +206,26 @@ void Scene::Shutdown() {
 	}
 }
 
-void Scene::Update(float deltaTime, ScriptingManager* scripting) {
+void Scene::Update(float deltaTime, ScriptingManager* scripting, JobSystem* jobs, const EngineSettings& settings) {
 	//m_MainCamera->Render(deltaTime);
 	m_MainCamera->GenerateViewMatrix();
-	m_MainCamera->UpdateTransform();
+	if (!settings.flatTransformHierarchy) {
+		m_Stats.recomputedTransforms += m_MainCamera->UpdateTransform();
+	}
 
 	//m_Models[1]->transform.position += Vector3(-25.0f, 0.0f, 4.0f);
 	//m_SceneRoot->children[0]->children[0]->children[0]->transform.rotation += Vector3::Up * DirectX::XMConvertToRadians(30.0f) * deltaTime;
 	//m_SceneRoot->children[0]->children[0]->children[0]->UpdateTransform();
-	m_SceneRoot->children[0]->children[0]->transform.rotation += Vector3::Up * DirectX::XMConvertToRadians(15.0f) * deltaTime;
+	Transform& carTransform = m_SceneRoot->children[0]->children[0]->transform;
+	carTransform.SetRotation(carTransform.rotation + Vector3::Up * DirectX::XMConvertToRadians(15.0f) * deltaTime);
 	//m_SceneRoot->children[0]->children[0]->UpdateTransform();
 	//m_Models[1]->transform.position += Vector3(25.0f, 0.0f, -4.0f);
-	m_SceneRoot->children[0]->transform.rotation += Vector3::Up * DirectX::XMConvertToRadians(15.0f) * deltaTime;
+	Transform& teapotTransform = m_SceneRoot->children[0]->transform;
+	teapotTransform.SetRotation(teapotTransform.rotation + Vector3::Up * DirectX::XMConvertToRadians(15.0f) * deltaTime);
 	//m_SceneRoot->children[0]->transform.scale = Vector3::One * 0.1f;
 	//m_SceneRoot->children[0]->UpdateTransform();
 	m_SceneRoot->Update(deltaTime, scripting);
-	m_SceneRoot->UpdateTransform();
+	UpdateTransforms(jobs, settings);
 
 	m_ShaderPayload.matrices.view = m_MainCamera->GetViewMatrix();
 	m_ShaderPayload.matrices.projection = m_MainCamera->GetProjectionMatrix();
@@ -236,14 +243,123 @@ void Scene::Update(float deltaTime, ScriptingManager* scripting) {
 	}
 }
 
-bool Scene::Render() {
+void Scene::UpdateTransforms(JobSystem* jobs, const EngineSettings& settings) {
+	if (settings.flatTransformHierarchy) {
+		m_Stats.recomputedTransforms += m_TransformHierarchy.Update(settings.parallelTransforms ? jobs : nullptr);
+		UpdateSpatialTree(m_TransformHierarchy.GetMovedNodes());
+	} else {
+		m_MovedNodes.clear();
+		m_Stats.recomputedTransforms += m_SceneRoot->UpdateTransform(false, &m_MovedNodes);
+		UpdateSpatialTree(m_MovedNodes);
+	}
+}
+
+bool Scene::Render(JobSystem* jobs, const EngineSettings& settings) {
+	m_Stats.Reset();
+	m_Stats.sceneNodes = m_TransformHierarchy.GetCount();
+
 	Frustum camFrustum(*m_MainCamera, 1.0f * m_ScreenWidth / m_ScreenHeight, SCREEN_NEAR, SCREEN_DEPTH);
-	if (!m_SceneRoot->Render(m_DeviceContext, &m_ShaderPayload, &camFrustum)) {
-		return false;
+	if (settings.spatialTreeCulling) {
+		// The tree only reports nodes near the frustum, the others keep their flag
+		for (unsigned int i = 0; i < m_RenderQueue.GetVisibleCount(); i++) {
+			m_RenderQueue.GetVisibleNode(i)->culled = true;
+		}
+		m_RenderQueue.Clear();
+		m_Stats.visitedNodes = m_SpatialTree.QueryFrustum(camFrustum, [this](int proxy, bool inside) {
+			SceneNode* node = static_cast<SceneNode*>(m_SpatialTree.GetUserData(proxy));
+			if (inside) {
+				node->culled = false;
+				m_RenderQueue.AddVisible(node);
+			} else {
+				node->culled = true;
+				m_RenderQueue.AddCandidate(node, node->GetWorldBounds());
+			}
+		});
+	} else {
+		m_RenderQueue.Clear();
+		m_SceneRoot->GatherRenderables(camFrustum, m_RenderQueue, &m_Stats);
+	}
+	m_RenderQueue.Cull(camFrustum, settings.parallelCulling ? jobs : nullptr, settings.temporalCulling, settings.boxCulling);
+	m_Stats.batchTestedModels = m_RenderQueue.GetCandidateCount();
+	m_Stats.planeTests = m_RenderQueue.GetPlaneTestCount();
+	m_Stats.boxCulledModels = m_RenderQueue.GetBoxCulledCount();
+
+	if (settings.occlusionCulling) {
+		RasterizeOccluders();
+	}
+
+	static_assert(Model::MAX_LOD_COUNT <= FrameStatistics::MAX_LOD_COUNT, "Every level needs its counters");
+	const Matrix& viewMatrix = m_MainCamera->GetViewMatrix();
+	const Matrix& projectionMatrix = m_MainCamera->GetProjectionMatrix();
+	const float minScreenSize = settings.smallObjectPixels / m_ScreenHeight;
+	MeshCulling meshCulling;
+	meshCulling.frustum = settings.meshCulling ? &camFrustum : nullptr;
+	meshCulling.boxCulling = settings.boxCulling;
+	for (unsigned int i = 0; i < m_RenderQueue.GetVisibleCount(); i++) {
+		SceneNode* node = m_RenderQueue.GetVisibleNode(i);
+		const Model* model = node->GetModel();
+		const float screenSize = Model::GetScreenSize(node->GetWorldBounds(), viewMatrix, projectionMatrix);
+		if (screenSize < minScreenSize) {
+			node->culled = true;
+			m_Stats.smallCulledModels++;
+			continue;
+		}
+		if (settings.occlusionCulling && !node->occluder && !m_OcclusionBuffer.IsVisible(node->GetWorldBox())) {
+			node->culled = true;
+			m_Stats.occludedModels++;
+			continue;
+		}
+
+		node->lod = settings.lodSelection ? model->SelectLod(screenSize, node->lod) : 0;
+		const unsigned int submittedTriangles = meshCulling.submittedTriangles;
+		if (!model->Render(m_DeviceContext, &m_ShaderPayload, node->transform.globalMatrix, &meshCulling, node->lod)) {
+			return false;
+		}
+		m_Stats.lodModels[node->lod]++;
+		m_Stats.lodTriangles[node->lod] += meshCulling.submittedTriangles - submittedTriangles;
+		m_Stats.renderedModels++;
 	}
+	m_Stats.testedMeshes = meshCulling.testedMeshes;
+	m_Stats.culledMeshes = meshCulling.culledMeshes;
 	return true;
 }
 
+void Scene::InsertIntoSpatialTree(SceneNode* node) {
+	if (node->GetModel()) {
+		node->spatialProxy = m_SpatialTree.Insert(AxisAlignedBox::FromBox(node->GetWorldBox()), node);
+	}
+	for (auto& child : node->children) {
+		InsertIntoSpatialTree(child.get());
+	}
+}
+
+void Scene::UpdateSpatialTree(const std::vector<SceneNode*>& movedNodes) {
+	for (SceneNode* node : movedNodes) {
+		m_SpatialTree.Update(node->spatialProxy, AxisAlignedBox::FromBox(node->GetWorldBox()));
+	}
+}
+
+void Scene::RasterizeOccluders() {
+	m_OcclusionBuffer.Clear(m_ShaderPayload.viewProjectionMatrix);
+	for (unsigned int i = 0; i < m_RenderQueue.GetVisibleCount(); i++) {
+		const SceneNode* node = m_RenderQueue.GetVisibleNode(i);
+		if (!node->occluder) {
+			continue;
+		}
+		for (const Mesh& mesh : node->GetModel()->GetMeshes()) {
+			const std::vector<Vertex>& vertices = mesh.GetVertices();
+			const std::vector<unsigned int>& indices = mesh.GetIndices();
+			if (vertices.empty()) {
+				continue;
+			}
+			m_OcclusionBuffer.RasterizeTriangles(&vertices[0].Position, vertices.size(), sizeof(Vertex),
+				indices.data(), indices.size(), mesh.transform.globalMatrix * node->transform.globalMatrix);
+		}
+	}
+	m_OcclusionBuffer.BuildHierarchy();
+	m_Stats.occluderTriangles = m_OcclusionBuffer.GetRasterizedTriangleCount();
+}
+
 void Scene::HandleResize(int screenWidth, int screenHeight) {
 	m_MainCamera->GenerateProjectionMatrices(screenWidth, screenHeight, SCREEN_DEPTH, SCREEN_NEAR);
 	m_ScreenWidth = screenWidth;
@@ -254,6 +370,14 @@ Camera* Scene::GetMainCamera() {
 	return m_MainCamera;
 }
 
-const SceneNode* Scene::GetSceneRoot() {
+SceneNode* Scene::GetSceneRoot() {
 	return m_SceneRoot.get();
-}
\ No newline at end of file
+}
+
+const FrameStatistics& Scene::GetStatistics() const {
+	return m_Stats;
+}
+
+const DynamicAabbTree& Scene::GetSpatialTree() const {
+	return m_SpatialTree;
+}
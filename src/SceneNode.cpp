@@ -1,54 +1,92 @@
 #include "SceneNode.h"
 
 #include "FrustumCulling.h"
+#include "FrameStatistics.h"
+#include "RenderQueue.h"
 #include <ScriptingManager.h>
 
+namespace {
+    // Nodes are only created on the main thread
+    unsigned int s_NextNodeId = 0;
+}
+
 SceneNode::SceneNode(std::string _name, const SceneNode* parent, const Model* model)
-    : name(_name), m_Parent(parent), m_Model(model) {}
+    : id(s_NextNodeId++), name(_name), m_Parent(parent), m_Model(model) {
+    UpdateWorldBounds();
+}
 
-bool SceneNode::Render(ID3D11DeviceContext* deviceContext, ShaderPayload* shaderPayload, Frustum* camFrustum) {
-    bool renderSuccess;
-    if (m_Model) {
-        if (camFrustum) {
-            if (m_Model->boundingSphere.IsOnFrustum(*camFrustum, transform.globalMatrix)) {
-                culled = false;
-                renderSuccess = m_Model->Render(deviceContext, shaderPayload, transform.globalMatrix);
-                if (!renderSuccess) {
-                    return false;
-                }
-            } else {
-                culled = true;
+void SceneNode::GatherRenderables(const Frustum& camFrustum, RenderQueue& queue, FrameStatistics* stats, bool insideFrustum) {
+    if (stats) {
+        stats->visitedNodes++;
+    }
+    if (!m_HasSubtreeBounds) {
+        return;
+    }
+
+    culled = false;
+    subtreeCulled = false;
+    // A leaf's subtree bound is its own bound, it goes to the batch test instead
+    if (!insideFrustum && !children.empty()) {
+        const FrustumIntersection intersection = m_SubtreeBounds.Classify(camFrustum);
+        if (intersection == FrustumIntersection::Outside) {
+            // Descendants keep their previous flags, the GUI shows them culled through this node
+            culled = true;
+            subtreeCulled = true;
+            if (stats) {
+                stats->culledSubtrees++;
             }
+            return;
         }
-        else {
-            renderSuccess = m_Model->Render(deviceContext, shaderPayload, transform.globalMatrix);
-            if (!renderSuccess) {
-                return false;
-            }
+        insideFrustum = intersection == FrustumIntersection::Inside;
+    }
+
+    if (m_Model) {
+        if (insideFrustum) {
+            queue.AddVisible(this);
+        } else {
+            // Cleared again by the culling pass if the node turns out visible
+            culled = true;
+            queue.AddCandidate(this, m_WorldBounds);
         }
     }
 
     for (auto& child : children) {
-        child->Render(deviceContext, shaderPayload, camFrustum);
+        child->GatherRenderables(camFrustum, queue, stats, insideFrustum);
     }
-
-    return true;
 }
 
-void SceneNode::UpdateTransform() {
-    if (m_Parent) {
-        transform.UpdateGlobalMatrix(m_Parent->transform.globalMatrix);
-    } else {
-        transform.UpdateGlobalMatrix(Matrix::Identity);
+unsigned int SceneNode::UpdateTransform(bool parentChanged, std::vector<SceneNode*>* movedNodes) {
+    unsigned int recomputed = 0;
+    bool changed = parentChanged || transform.IsDirty();
+    if (changed) {
+        if (m_Parent) {
+            transform.UpdateGlobalMatrix(m_Parent->transform);
+        } else {
+            transform.UpdateGlobalMatrix();
+        }
+        UpdateWorldBounds();
+        if (movedNodes && m_Model) {
+            movedNodes->push_back(this);
+        }
+        recomputed++;
     }
     for (auto& child : children) {
-        child->UpdateTransform();
+        recomputed += child->UpdateTransform(changed, movedNodes);
+        if (child->RefitSubtreeBounds()) {
+            m_SubtreeBoundsDirty = true;
+        }
     }
+    if (!m_Parent) {
+        RefitSubtreeBounds();
+    }
+    return recomputed;
 }
 
 void SceneNode::Update(float deltaTime, ScriptingManager* scripting) {
-    if (moving)
+    if (moving) {
         dir = scripting->luaUpdate(transform.position, dir, deltaTime);
+        transform.MarkDirty();
+    }
 
     for (auto& child : children) {
         child->Update(deltaTime, scripting);
@@ -56,18 +94,73 @@ void SceneNode::Update(float deltaTime, ScriptingManager* scripting) {
 }
 
 void SceneNode::AddChild(std::unique_ptr<SceneNode>&& child) {
-    child->transform.UpdateGlobalMatrix(transform.globalMatrix);
+    // The global matrix is resolved on the next UpdateTransform pass,
+    // once the whole branch is attached to the hierarchy
+    child->transform.MarkGlobalDirty();
     children.push_back(std::move(child));
+    m_SubtreeBoundsDirty = true;
 }
 
 void SceneNode::SetModel(const Model* model) {
     m_Model = model;
+    UpdateWorldBounds();
+}
+
+void SceneNode::UpdateWorldBounds() {
+    if (m_Model) {
+        m_WorldBounds = m_Model->boundingSphere.Transformed(transform);
+        m_WorldBox = m_Model->boundingBox.Transformed(transform.globalMatrix);
+        m_SubtreeBoundsDirty = true;
+        cullingState.inside = false;
+    }
+}
+
+const BoundingSphere& SceneNode::GetWorldBounds() const {
+    return m_WorldBounds;
+}
+
+const OrientedBox& SceneNode::GetWorldBox() const {
+    return m_WorldBox;
+}
+
+bool SceneNode::RefitSubtreeBounds() {
+    if (!m_SubtreeBoundsDirty) {
+        return false;
+    }
+
+    m_HasSubtreeBounds = m_Model != nullptr;
+    m_SubtreeBounds = m_WorldBounds;
+    for (const auto& child : children) {
+        if (!child->m_HasSubtreeBounds) {
+            continue;
+        }
+        m_SubtreeBounds = m_HasSubtreeBounds ? BoundingSphere::Merge(m_SubtreeBounds, child->m_SubtreeBounds) : child->m_SubtreeBounds;
+        m_HasSubtreeBounds = true;
+    }
+    m_SubtreeBoundsDirty = false;
+    return true;
+}
+
+void SceneNode::MarkSubtreeBoundsDirty() {
+    m_SubtreeBoundsDirty = true;
+}
+
+bool SceneNode::HasSubtreeBounds() const {
+    return m_HasSubtreeBounds;
+}
+
+const BoundingSphere& SceneNode::GetSubtreeBounds() const {
+    return m_SubtreeBounds;
 }
 
 const Model* SceneNode::GetModel() const {
     return m_Model;
 }
 
+const SceneNode* SceneNode::GetParent() const {
+    return m_Parent;
+}
+
 std::string SceneNode::GetType() {
     return "node";
 }
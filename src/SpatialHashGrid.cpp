@@ -0,0 +1,129 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialHashGrid::SpatialHashGrid(float cellSize) {
+    SetCellSize(cellSize);
+}
+
+void SpatialHashGrid::FindPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+    std::vector<BodyPair>& pairs) {
+    m_Entries.clear();
+    m_OversizedBodies.clear();
+    for (unsigned int body = 0; body < bounds.size(); body++) {
+        const AxisAlignedBox& box = bounds[body];
+        const int lowerX = ToCell(box.lower.x), upperX = ToCell(box.upper.x);
+        const int lowerY = ToCell(box.lower.y), upperY = ToCell(box.upper.y);
+        const int lowerZ = ToCell(box.lower.z), upperZ = ToCell(box.upper.z);
+        if (upperX - lowerX >= MAX_CELLS_PER_AXIS || upperY - lowerY >= MAX_CELLS_PER_AXIS || upperZ - lowerZ >= MAX_CELLS_PER_AXIS) {
+            m_OversizedBodies.push_back(body);
+            continue;
+        }
+        for (int x = lowerX; x <= upperX; x++) {
+            for (int y = lowerY; y <= upperY; y++) {
+                for (int z = lowerZ; z <= upperZ; z++) {
+                    m_Entries.push_back({ x, y, z, body });
+                }
+            }
+        }
+    }
+
+    // Power of two with at least two buckets per entry, keeps collisions rare
+    unsigned int bucketCount = 1;
+    while (bucketCount < 2 * m_Entries.size()) {
+        bucketCount *= 2;
+    }
+    const uint32_t bucketMask = bucketCount - 1;
+
+    // Counting sort of the entries by bucket
+    m_BucketStarts.assign(bucketCount + 1, 0);
+    m_EntryBuckets.resize(m_Entries.size());
+    for (size_t i = 0; i < m_Entries.size(); i++) {
+        const Entry& entry = m_Entries[i];
+        m_EntryBuckets[i] = Hash(entry.x, entry.y, entry.z) & bucketMask;
+        m_BucketStarts[m_EntryBuckets[i] + 1]++;
+    }
+    for (unsigned int bucket = 0; bucket < bucketCount; bucket++) {
+        m_BucketStarts[bucket + 1] += m_BucketStarts[bucket];
+    }
+    m_SortedEntries.resize(m_Entries.size());
+    // Walks the starts forward while filling, they are shifted back afterwards
+    for (size_t i = 0; i < m_Entries.size(); i++) {
+        m_SortedEntries[m_BucketStarts[m_EntryBuckets[i]]++] = m_Entries[i];
+    }
+    for (unsigned int bucket = bucketCount; bucket > 0; bucket--) {
+        m_BucketStarts[bucket] = m_BucketStarts[bucket - 1];
+    }
+    m_BucketStarts[0] = 0;
+
+    for (unsigned int bucket = 0; bucket < bucketCount; bucket++) {
+        const unsigned int end = m_BucketStarts[bucket + 1];
+        for (unsigned int i = m_BucketStarts[bucket]; i + 1 < end; i++) {
+            const Entry& entry = m_SortedEntries[i];
+            const AxisAlignedBox& box = bounds[entry.body];
+            for (unsigned int j = i + 1; j < end; j++) {
+                const Entry& other = m_SortedEntries[j];
+                // Different cells hashed into the same bucket
+                if (entry.x != other.x || entry.y != other.y || entry.z != other.z) {
+                    continue;
+                }
+                if (!filters[entry.body].ShouldCollide(filters[other.body])) {
+                    continue;
+                }
+                const AxisAlignedBox& otherBox = bounds[other.body];
+                if (!box.Overlaps(otherBox)) {
+                    continue;
+                }
+                const Vector3 overlapLower = Vector3::Max(box.lower, otherBox.lower);
+                if (ToCell(overlapLower.x) == entry.x && ToCell(overlapLower.y) == entry.y && ToCell(overlapLower.z) == entry.z) {
+                    pairs.push_back({ std::min(entry.body, other.body), std::max(entry.body, other.body) });
+                }
+            }
+        }
+    }
+    FindOversizedPairs(bounds, filters, pairs);
+}
+
+void SpatialHashGrid::FindOversizedPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+    std::vector<BodyPair>& pairs) const {
+    // Against every body, once per pair when both are oversized
+    for (unsigned int body : m_OversizedBodies) {
+        for (unsigned int other = 0; other < bounds.size(); other++) {
+            if (other == body || !bounds[body].Overlaps(bounds[other]) || !filters[body].ShouldCollide(filters[other])) {
+                continue;
+            }
+            const bool otherOversized = std::binary_search(m_OversizedBodies.begin(), m_OversizedBodies.end(), other);
+            if (otherOversized && other < body) {
+                continue;
+            }
+            pairs.push_back({ std::min(body, other), std::max(body, other) });
+        }
+    }
+}
+
+void SpatialHashGrid::SetCellSize(float cellSize) {
+    m_CellSize = cellSize;
+    m_InverseCellSize = 1.0f / cellSize;
+}
+
+float SpatialHashGrid::GetCellSize() const {
+    return m_CellSize;
+}
+
+unsigned int SpatialHashGrid::GetEntryCount() const {
+    return static_cast<unsigned int>(m_Entries.size());
+}
+
+unsigned int SpatialHashGrid::GetBucketCount() const {
+    return m_BucketStarts.empty() ? 0 : static_cast<unsigned int>(m_BucketStarts.size() - 1);
+}
+
+int SpatialHashGrid::ToCell(float coordinate) const {
+    return static_cast<int>(std::floor(coordinate * m_InverseCellSize));
+}
+
+uint32_t SpatialHashGrid::Hash(int x, int y, int z) {
+    // Large primes from Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+    return (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u) ^ (static_cast<uint32_t>(z) * 83492791u);
+}
@@ -0,0 +1,103 @@
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+
+namespace {
+    float GetComponent(const Vector3& v, unsigned int axis) {
+        return (&v.x)[axis];
+    }
+
+    // Switching axes costs a full sort, so the current one is kept unless another
+    // varies this much more
+    const float AXIS_SWITCH_RATIO = 1.5f;
+}
+
+void SweepAndPrune::FindPairs(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters,
+    std::vector<BodyPair>& pairs) {
+    const unsigned int axis = ChooseAxis(bounds);
+    SortEntries(bounds, filters, axis);
+
+    const unsigned int otherAxis1 = (axis + 1) % 3;
+    const unsigned int otherAxis2 = (axis + 2) % 3;
+    const size_t count = m_Entries.size();
+    for (size_t i = 0; i < count; i++) {
+        const Entry& entry = m_Entries[i];
+        const float upper = GetComponent(entry.box.upper, axis);
+        for (size_t j = i + 1; j < count && GetComponent(m_Entries[j].box.lower, axis) <= upper; j++) {
+            const Entry& other = m_Entries[j];
+            // Most candidates fail, & instead of && avoids a mispredicted branch per comparison
+            if (((entry.filter.layer & other.filter.mask) != 0) & ((other.filter.layer & entry.filter.mask) != 0)
+                & (GetComponent(entry.box.lower, otherAxis1) <= GetComponent(other.box.upper, otherAxis1))
+                & (GetComponent(other.box.lower, otherAxis1) <= GetComponent(entry.box.upper, otherAxis1))
+                & (GetComponent(entry.box.lower, otherAxis2) <= GetComponent(other.box.upper, otherAxis2))
+                & (GetComponent(other.box.lower, otherAxis2) <= GetComponent(entry.box.upper, otherAxis2))) {
+                pairs.push_back({ std::min(entry.body, other.body), std::max(entry.body, other.body) });
+            }
+        }
+    }
+}
+
+unsigned int SweepAndPrune::GetAxis() const {
+    return m_Axis;
+}
+
+unsigned int SweepAndPrune::GetSwapCount() const {
+    return m_SwapCount;
+}
+
+unsigned int SweepAndPrune::ChooseAxis(const std::vector<AxisAlignedBox>& bounds) const {
+    if (bounds.empty()) {
+        return m_Axis;
+    }
+
+    // Variance of the box centers, scaled by the count on both sides
+    Vector3 sum = Vector3::Zero;
+    Vector3 sumSquared = Vector3::Zero;
+    for (const AxisAlignedBox& box : bounds) {
+        const Vector3 center = box.lower + box.upper;
+        sum += center;
+        sumSquared += center * center;
+    }
+    const float count = static_cast<float>(bounds.size());
+    const Vector3 variance = sumSquared * count - sum * sum;
+
+    unsigned int axis = m_Axis;
+    for (unsigned int i = 0; i < 3; i++) {
+        if (GetComponent(variance, i) > AXIS_SWITCH_RATIO * GetComponent(variance, axis)) {
+            axis = i;
+        }
+    }
+    return axis;
+}
+
+void SweepAndPrune::SortEntries(const std::vector<AxisAlignedBox>& bounds, const std::vector<CollisionFilter>& filters, unsigned int axis) {
+    m_SwapCount = 0;
+    if (m_Entries.size() != bounds.size() || axis != m_Axis) {
+        m_Axis = axis;
+        m_Entries.resize(bounds.size());
+        for (unsigned int i = 0; i < bounds.size(); i++) {
+            m_Entries[i] = { bounds[i], filters[i], i };
+        }
+        std::sort(m_Entries.begin(), m_Entries.end(), [axis](const Entry& a, const Entry& b) {
+            return GetComponent(a.box.lower, axis) < GetComponent(b.box.lower, axis);
+        });
+        return;
+    }
+
+    // Same bodies in last frame's order, only the boxes changed
+    for (Entry& entry : m_Entries) {
+        entry.box = bounds[entry.body];
+        entry.filter = filters[entry.body];
+    }
+    for (size_t i = 1; i < m_Entries.size(); i++) {
+        const Entry entry = m_Entries[i];
+        const float key = GetComponent(entry.box.lower, axis);
+        size_t j = i;
+        while (j > 0 && GetComponent(m_Entries[j - 1].box.lower, axis) > key) {
+            m_Entries[j] = m_Entries[j - 1];
+            j--;
+        }
+        m_Entries[j] = entry;
+        m_SwapCount += static_cast<unsigned int>(i - j);
+    }
+}
@@ -1,27 +1,151 @@
 #include "Transform.h"
 
+#include <algorithm>
+
+#include "TransformHierarchy.h"
+
 Transform::Transform(const Matrix& parentGlobalMatrix, Vector3 position, Vector3 rotation, Vector3 scale)
-    : position(position), rotation(rotation), scale(scale) {
-    UpdateGlobalMatrix(parentGlobalMatrix);
+    : position(position), rotation(rotation), scale(scale), m_Orientation(Quaternion::CreateFromYawPitchRoll(rotation)) {
+    // Only done once at construction, updates afterwards take the parent Transform
+    Vector3 parentScale, parentPosition;
+    Quaternion parentOrientation;
+    parentGlobalMatrix.Decompose(parentScale, parentOrientation, parentPosition);
+    UpdateGlobalMatrix(parentGlobalMatrix, parentOrientation);
 }
 
 Transform::Transform(Vector3 position, Vector3 rotation, Vector3 scale)
-    : Transform(Matrix::Identity, position, rotation, scale) {}
+    : position(position), rotation(rotation), scale(scale), m_Orientation(Quaternion::CreateFromYawPitchRoll(rotation)) {
+    UpdateGlobalMatrix();
+}
 
 Transform::Transform(const Matrix& parentGlobalMatrix, Matrix localMatrix) {
-    Quaternion quatRot;
-    localMatrix.Decompose(scale, quatRot, position);
-    rotation = quatRot.ToEuler();
+    localMatrix.Decompose(scale, m_Orientation, position);
+    rotation = m_Orientation.ToEuler();
     globalMatrix = localMatrix * parentGlobalMatrix;
+    Vector3 worldPosition;
+    globalMatrix.Decompose(m_WorldScale, m_WorldOrientation, worldPosition);
 }
 
-Matrix Transform::GetLocalMatrix() {
+Transform::Transform(const Transform& other)
+    : position(other.position), rotation(other.rotation), scale(other.scale), globalMatrix(other.globalMatrix),
+    m_Orientation(other.m_Orientation), m_WorldOrientation(other.m_WorldOrientation), m_WorldScale(other.m_WorldScale),
+    m_LocalMatrix(other.m_LocalMatrix), m_LocalDirty(other.m_LocalDirty), m_GlobalDirty(other.m_GlobalDirty) {}
+
+Transform& Transform::operator=(const Transform& other) {
+    position = other.position;
+    rotation = other.rotation;
+    scale = other.scale;
+    globalMatrix = other.globalMatrix;
+    m_WorldOrientation = other.m_WorldOrientation;
+    m_WorldScale = other.m_WorldScale;
+    MarkDirty();
+    return *this;
+}
+
+Matrix Transform::ComposeLocalMatrix(const Vector3& position, const Vector3& rotation, const Vector3& scale) {
     Matrix translate = Matrix::CreateTranslation(position);
     Matrix rotate = Matrix::CreateFromYawPitchRoll(rotation);
     Matrix scaling = Matrix::CreateScale(scale);
     return scaling * rotate * translate;
 }
 
-void Transform::UpdateGlobalMatrix(const Matrix& parentGlobalMatrix) {
+Vector3 Transform::GetAxisLengths(const Matrix& matrix) {
+    return Vector3(matrix.Right().Length(), matrix.Up().Length(), matrix.Backward().Length());
+}
+
+Matrix Transform::GetLocalMatrix() {
+    if (m_LocalDirty) {
+        m_LocalMatrix = ComposeLocalMatrix(position, rotation, scale);
+        m_LocalDirty = false;
+    }
+    return m_LocalMatrix;
+}
+
+void Transform::UpdateGlobalMatrix(const Transform& parent) {
+    UpdateGlobalMatrix(parent.globalMatrix, parent.m_WorldOrientation);
+}
+
+void Transform::UpdateGlobalMatrix() {
+    UpdateGlobalMatrix(Matrix::Identity, Quaternion::Identity);
+}
+
+void Transform::UpdateGlobalMatrix(const Matrix& parentGlobalMatrix, const Quaternion& parentOrientation) {
     globalMatrix = GetLocalMatrix() * parentGlobalMatrix;
+    // Row vectors, the local rotation is applied before the parent one
+    m_WorldOrientation = m_Orientation * parentOrientation;
+    m_WorldScale = GetAxisLengths(globalMatrix);
+    m_GlobalDirty = false;
+}
+
+void Transform::SetPosition(const Vector3& _position) {
+    position = _position;
+    MarkDirty();
+}
+
+void Transform::SetRotation(const Vector3& _rotation) {
+    rotation = _rotation;
+    MarkDirty();
+}
+
+void Transform::SetOrientation(const Quaternion& orientation) {
+    m_Orientation = orientation;
+    rotation = orientation.ToEuler();
+    Invalidate();
+}
+
+void Transform::SetScale(const Vector3& _scale) {
+    scale = _scale;
+    MarkDirty();
+}
+
+void Transform::MarkDirty() {
+    m_Orientation = Quaternion::CreateFromYawPitchRoll(rotation);
+    Invalidate();
+}
+
+void Transform::Invalidate() {
+    m_LocalDirty = true;
+    m_GlobalDirty = true;
+    if (m_Hierarchy) {
+        m_Hierarchy->SetLocal(m_HierarchyIndex, position, rotation, m_Orientation, scale);
+    }
+}
+
+void Transform::MarkGlobalDirty() {
+    m_GlobalDirty = true;
+    if (m_Hierarchy) {
+        m_Hierarchy->MarkGlobalDirty(m_HierarchyIndex);
+    }
+}
+
+bool Transform::IsDirty() const {
+    return m_GlobalDirty;
+}
+
+bool Transform::IsInHierarchy() const {
+    return m_Hierarchy != nullptr;
+}
+
+unsigned int Transform::GetHierarchyIndex() const {
+    return m_HierarchyIndex;
+}
+
+const Quaternion& Transform::GetOrientation() const {
+    return m_Orientation;
+}
+
+Vector3 Transform::GetWorldPosition() const {
+    return globalMatrix.Translation();
+}
+
+const Quaternion& Transform::GetWorldOrientation() const {
+    return m_WorldOrientation;
+}
+
+const Vector3& Transform::GetWorldScale() const {
+    return m_WorldScale;
+}
+
+float Transform::GetMaxWorldScale() const {
+    return std::max(std::max(m_WorldScale.x, m_WorldScale.y), m_WorldScale.z);
 }
@@ -0,0 +1,236 @@
+#include "TransformHierarchy.h"
+
+#include <atomic>
+
+#include "SceneNode.h"
+#include "JobSystem.h"
+
+void TransformHierarchy::Build(SceneNode* root) {
+    Clear();
+    if (!root) {
+        return;
+    }
+
+    // Breadth-first traversal, m_Nodes doubles as the queue
+    m_Nodes.push_back(root);
+    m_Parents.push_back(INVALID_INDEX);
+    size_t levelEnd = 1;
+    m_DepthOffsets.push_back(0);
+    for (size_t i = 0; i < m_Nodes.size(); i++) {
+        if (i == levelEnd) {
+            m_DepthOffsets.push_back(static_cast<unsigned int>(i));
+            levelEnd = m_Nodes.size();
+        }
+        for (auto& child : m_Nodes[i]->children) {
+            m_Nodes.push_back(child.get());
+            m_Parents.push_back(static_cast<unsigned int>(i));
+        }
+    }
+    m_DepthOffsets.push_back(static_cast<unsigned int>(m_Nodes.size()));
+
+    const size_t count = m_Nodes.size();
+    for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+        &m_RotationX, &m_RotationY, &m_RotationZ, &m_ScaleX, &m_ScaleY, &m_ScaleZ }) {
+        component->resize(count);
+    }
+    m_Orientations.resize(count);
+    m_LocalMatrices.resize(count);
+    m_GlobalMatrices.resize(count);
+    m_WorldOrientations.resize(count);
+    m_WorldScales.resize(count);
+    m_LocalDirty.assign(count, 1);
+    m_GlobalDirty.assign(count, 1);
+
+    for (size_t i = 0; i < count; i++) {
+        Transform& transform = m_Nodes[i]->transform;
+        transform.m_Hierarchy = this;
+        transform.m_HierarchyIndex = static_cast<unsigned int>(i);
+        SetLocal(static_cast<unsigned int>(i), transform.position, transform.rotation, transform.m_Orientation, transform.scale);
+    }
+    m_AnyDirty = true;
+}
+
+void TransformHierarchy::Clear() {
+    for (SceneNode* node : m_Nodes) {
+        node->transform.m_Hierarchy = nullptr;
+    }
+    for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+        &m_RotationX, &m_RotationY, &m_RotationZ, &m_ScaleX, &m_ScaleY, &m_ScaleZ }) {
+        component->clear();
+    }
+    m_Orientations.clear();
+    m_Parents.clear();
+    m_LocalMatrices.clear();
+    m_GlobalMatrices.clear();
+    m_WorldOrientations.clear();
+    m_WorldScales.clear();
+    m_LocalDirty.clear();
+    m_GlobalDirty.clear();
+    m_DepthOffsets.clear();
+    m_Nodes.clear();
+    m_MovedNodes.clear();
+    m_AnyDirty = false;
+}
+
+unsigned int TransformHierarchy::Update(JobSystem* jobs) {
+    if (!m_AnyDirty) {
+        m_MovedNodes.clear();
+        return 0;
+    }
+
+    unsigned int recomputed = 0;
+    const unsigned int count = GetCount();
+    if (!jobs) {
+        recomputed = UpdateRange(0, count);
+        // Flags are only cleared after the write back, children read their parent's flag in the pass above
+        WriteBackRange(0, count);
+        RefitBounds();
+        m_AnyDirty = false;
+        return recomputed;
+    }
+
+    std::atomic<unsigned int> parallelRecomputed{ 0 };
+    for (unsigned int depth = 0; depth < GetDepthCount(); depth++) {
+        const unsigned int levelBegin = m_DepthOffsets[depth];
+        const unsigned int levelSize = m_DepthOffsets[depth + 1] - levelBegin;
+        if (levelSize <= PARALLEL_GRAIN_SIZE) {
+            recomputed += UpdateRange(levelBegin, levelBegin + levelSize);
+            continue;
+        }
+        jobs->ParallelFor(levelSize, PARALLEL_GRAIN_SIZE, [&](unsigned int begin, unsigned int end) {
+            parallelRecomputed.fetch_add(UpdateRange(levelBegin + begin, levelBegin + end), std::memory_order_relaxed);
+        });
+    }
+    jobs->ParallelFor(count, PARALLEL_GRAIN_SIZE, [this](unsigned int begin, unsigned int end) {
+        WriteBackRange(begin, end);
+    });
+    RefitBounds();
+    m_AnyDirty = false;
+
+    return recomputed + parallelRecomputed.load();
+}
+
+LocalTransformArrays TransformHierarchy::GetLocalArrays() const {
+    return {
+        m_PositionX.data(), m_PositionY.data(), m_PositionZ.data(),
+        m_RotationX.data(), m_RotationY.data(), m_RotationZ.data(),
+        m_ScaleX.data(), m_ScaleY.data(), m_ScaleZ.data()
+    };
+}
+
+unsigned int TransformHierarchy::UpdateRange(unsigned int begin, unsigned int end) {
+    // Local matrices don't depend on the parent, compose all of them first
+    const LocalTransformArrays arrays = GetLocalArrays();
+    unsigned int batch[LOCAL_BATCH_SIZE];
+    unsigned int batchCount = 0;
+    for (unsigned int i = begin; i < end; i++) {
+        if (!m_LocalDirty[i]) {
+            continue;
+        }
+        m_LocalDirty[i] = 0;
+        batch[batchCount++] = i;
+        if (batchCount == LOCAL_BATCH_SIZE) {
+            TransformKernels::ComposeLocalMatrices(arrays, batch, batchCount, m_LocalMatrices.data());
+            batchCount = 0;
+        }
+    }
+    if (batchCount > 0) {
+        TransformKernels::ComposeLocalMatrices(arrays, batch, batchCount, m_LocalMatrices.data());
+    }
+
+    unsigned int recomputed = 0;
+    for (unsigned int i = begin; i < end; i++) {
+        const unsigned int parent = m_Parents[i];
+        if (parent != INVALID_INDEX && m_GlobalDirty[parent]) {
+            m_GlobalDirty[i] = 1;
+        }
+        if (!m_GlobalDirty[i]) {
+            continue;
+        }
+
+        if (parent != INVALID_INDEX) {
+            m_GlobalMatrices[i] = m_LocalMatrices[i] * m_GlobalMatrices[parent];
+            m_WorldOrientations[i] = m_Orientations[i] * m_WorldOrientations[parent];
+        } else {
+            m_GlobalMatrices[i] = m_LocalMatrices[i];
+            m_WorldOrientations[i] = m_Orientations[i];
+        }
+        m_WorldScales[i] = Transform::GetAxisLengths(m_GlobalMatrices[i]);
+        recomputed++;
+    }
+    return recomputed;
+}
+
+void TransformHierarchy::WriteBackRange(unsigned int begin, unsigned int end) {
+    for (unsigned int i = begin; i < end; i++) {
+        if (m_GlobalDirty[i]) {
+            Transform& transform = m_Nodes[i]->transform;
+            transform.globalMatrix = m_GlobalMatrices[i];
+            transform.m_WorldOrientation = m_WorldOrientations[i];
+            transform.m_WorldScale = m_WorldScales[i];
+            transform.m_GlobalDirty = false;
+            m_Nodes[i]->UpdateWorldBounds();
+        }
+    }
+}
+
+void TransformHierarchy::RefitBounds() {
+    m_MovedNodes.clear();
+    // Children are stored after their parents, walking backwards refits bottom-up
+    for (unsigned int i = GetCount(); i-- > 0;) {
+        if (m_GlobalDirty[i]) {
+            if (m_Nodes[i]->GetModel()) {
+                m_MovedNodes.push_back(m_Nodes[i]);
+            }
+            m_GlobalDirty[i] = 0;
+        }
+        if (m_Nodes[i]->RefitSubtreeBounds() && m_Parents[i] != INVALID_INDEX) {
+            m_Nodes[m_Parents[i]]->MarkSubtreeBoundsDirty();
+        }
+    }
+}
+
+void TransformHierarchy::SetLocal(unsigned int index, const Vector3& position, const Vector3& rotation, const Quaternion& orientation, const Vector3& scale) {
+    m_PositionX[index] = position.x;
+    m_PositionY[index] = position.y;
+    m_PositionZ[index] = position.z;
+    m_RotationX[index] = rotation.x;
+    m_RotationY[index] = rotation.y;
+    m_RotationZ[index] = rotation.z;
+    m_ScaleX[index] = scale.x;
+    m_ScaleY[index] = scale.y;
+    m_ScaleZ[index] = scale.z;
+    m_Orientations[index] = orientation;
+    m_LocalDirty[index] = 1;
+    m_GlobalDirty[index] = 1;
+    m_AnyDirty = true;
+}
+
+void TransformHierarchy::MarkGlobalDirty(unsigned int index) {
+    m_GlobalDirty[index] = 1;
+    m_AnyDirty = true;
+}
+
+unsigned int TransformHierarchy::GetCount() const {
+    return static_cast<unsigned int>(m_Parents.size());
+}
+
+unsigned int TransformHierarchy::GetDepthCount() const {
+    return m_DepthOffsets.empty() ? 0 : static_cast<unsigned int>(m_DepthOffsets.size() - 1);
+}
+
+unsigned int TransformHierarchy::GetParent(unsigned int index) const {
+    return m_Parents[index];
+}
+
+const Matrix& TransformHierarchy::GetGlobalMatrix(unsigned int index) const {
+    return m_GlobalMatrices[index];
+}
+
+SceneNode* TransformHierarchy::GetNode(unsigned int index) const {
+    return m_Nodes[index];
+}
+
+const std::vector<SceneNode*>& TransformHierarchy::GetMovedNodes() const {
+    return m_MovedNodes;
+}
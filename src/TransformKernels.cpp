@@ -0,0 +1,286 @@
+#include "TransformKernels.h"
+
+#include <cmath>
+
+#ifdef TRANSFORM_KERNELS_SSE
+#include <emmintrin.h>
+#endif
+#ifdef TRANSFORM_KERNELS_AVX
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Same closed form as XMMatrixRotationRollPitchYaw (roll, then pitch, then yaw),
+    // with the scale folded into the rows and the translation in the last row
+    void ComposeElement(const LocalTransformArrays& a, unsigned int i, Matrix& m) {
+        const float sinPitch = sinf(a.rotationX[i]), cosPitch = cosf(a.rotationX[i]);
+        const float sinYaw = sinf(a.rotationY[i]), cosYaw = cosf(a.rotationY[i]);
+        const float sinRoll = sinf(a.rotationZ[i]), cosRoll = cosf(a.rotationZ[i]);
+
+        m._11 = a.scaleX[i] * (cosRoll * cosYaw + sinRoll * sinPitch * sinYaw);
+        m._12 = a.scaleX[i] * (sinRoll * cosPitch);
+        m._13 = a.scaleX[i] * (sinRoll * sinPitch * cosYaw - cosRoll * sinYaw);
+        m._14 = 0.0f;
+        m._21 = a.scaleY[i] * (cosRoll * sinPitch * sinYaw - sinRoll * cosYaw);
+        m._22 = a.scaleY[i] * (cosRoll * cosPitch);
+        m._23 = a.scaleY[i] * (sinRoll * sinYaw + cosRoll * sinPitch * cosYaw);
+        m._24 = 0.0f;
+        m._31 = a.scaleZ[i] * (cosPitch * sinYaw);
+        m._32 = a.scaleZ[i] * (-sinPitch);
+        m._33 = a.scaleZ[i] * (cosPitch * cosYaw);
+        m._34 = 0.0f;
+        m._41 = a.positionX[i];
+        m._42 = a.positionY[i];
+        m._43 = a.positionZ[i];
+        m._44 = 1.0f;
+    }
+
+#ifdef TRANSFORM_KERNELS_SSE
+    const float INV_2PI = 0.159154943f;
+
+    struct SSEOps {
+        using V = __m128;
+        static constexpr unsigned int WIDTH = 4;
+
+        static V Set1(float v) { return _mm_set1_ps(v); }
+        static V Load(const float* p) { return _mm_loadu_ps(p); }
+        static V Add(V a, V b) { return _mm_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V And(V a, V b) { return _mm_and_ps(a, b); }
+        static V AndNot(V a, V b) { return _mm_andnot_ps(a, b); }
+        static V Or(V a, V b) { return _mm_or_ps(a, b); }
+        static V CmpLe(V a, V b) { return _mm_cmple_ps(a, b); }
+        static V Round(V a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+        // mask ? b : a
+        static V Select(V a, V b, V mask) { return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b)); }
+
+        // elements holds _11, _12, _13, _21, ..., _33, _41, _42, _43 with one node per lane
+        static void Store(const V elements[12], Matrix* const* out) {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (int row = 0; row < 4; row++) {
+                __m128 r0 = elements[row * 3];
+                __m128 r1 = elements[row * 3 + 1];
+                __m128 r2 = elements[row * 3 + 2];
+                __m128 r3 = row == 3 ? one : zero;
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(out[0]->m[row], r0);
+                _mm_storeu_ps(out[1]->m[row], r1);
+                _mm_storeu_ps(out[2]->m[row], r2);
+                _mm_storeu_ps(out[3]->m[row], r3);
+            }
+        }
+    };
+#endif
+
+#ifdef TRANSFORM_KERNELS_AVX
+    struct AVXOps {
+        using V = __m256;
+        static constexpr unsigned int WIDTH = 8;
+
+        static V Set1(float v) { return _mm256_set1_ps(v); }
+        static V Load(const float* p) { return _mm256_loadu_ps(p); }
+        static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V And(V a, V b) { return _mm256_and_ps(a, b); }
+        static V AndNot(V a, V b) { return _mm256_andnot_ps(a, b); }
+        static V Or(V a, V b) { return _mm256_or_ps(a, b); }
+        static V CmpLe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static V Round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static V Select(V a, V b, V mask) { return _mm256_blendv_ps(a, b, mask); }
+
+        static void Store(const V elements[12], Matrix* const* out) {
+            __m128 low[12], high[12];
+            for (int i = 0; i < 12; i++) {
+                low[i] = _mm256_castps256_ps128(elements[i]);
+                high[i] = _mm256_extractf128_ps(elements[i], 1);
+            }
+            SSEOps::Store(low, out);
+            SSEOps::Store(high, out + 4);
+        }
+    };
+#endif
+
+#ifdef TRANSFORM_KERNELS_SSE
+    // Vectorized sine and cosine with the range reduction and
+    // minimax polynomials used by XMVectorSinCos
+    template<typename Ops>
+    void SinCos(typename Ops::V angle, typename Ops::V& sinOut, typename Ops::V& cosOut) {
+        using V = typename Ops::V;
+
+        // Map to [-pi, pi]
+        V x = Ops::Sub(angle, Ops::Mul(Ops::Set1(DirectX::XM_2PI), Ops::Round(Ops::Mul(angle, Ops::Set1(INV_2PI)))));
+
+        // Map to [-pi/2, pi/2] with sin(y) = sin(x), cos(y) = sign * cos(x)
+        const V signMask = Ops::Set1(-0.0f);
+        V sign = Ops::And(x, signMask);
+        V reflected = Ops::Sub(Ops::Or(Ops::Set1(DirectX::XM_PI), sign), x);
+        V inRange = Ops::CmpLe(Ops::AndNot(signMask, x), Ops::Set1(DirectX::XM_PIDIV2));
+        x = Ops::Select(reflected, x, inRange);
+        V cosSign = Ops::Select(Ops::Set1(-1.0f), Ops::Set1(1.0f), inRange);
+        V x2 = Ops::Mul(x, x);
+
+        V s = Ops::Set1(-2.3889859e-08f);
+        s = Ops::Add(Ops::Mul(s, x2), Ops::Set1(2.7525562e-06f));
+        s = Ops::Add(Ops::Mul(s, x2), Ops::Set1(-0.00019840874f));
+        s = Ops::Add(Ops::Mul(s, x2), Ops::Set1(0.0083333310f));
+        s = Ops::Add(Ops::Mul(s, x2), Ops::Set1(-0.16666667f));
+        s = Ops::Add(Ops::Mul(s, x2), Ops::Set1(1.0f));
+        sinOut = Ops::Mul(s, x);
+
+        V c = Ops::Set1(-2.6051615e-07f);
+        c = Ops::Add(Ops::Mul(c, x2), Ops::Set1(2.4760495e-05f));
+        c = Ops::Add(Ops::Mul(c, x2), Ops::Set1(-0.0013888378f));
+        c = Ops::Add(Ops::Mul(c, x2), Ops::Set1(0.041666638f));
+        c = Ops::Add(Ops::Mul(c, x2), Ops::Set1(-0.5f));
+        c = Ops::Add(Ops::Mul(c, x2), Ops::Set1(1.0f));
+        cosOut = Ops::Mul(c, cosSign);
+    }
+
+    // components: position xyz, rotation xyz, scale xyz
+    template<typename Ops>
+    void ComposeElements(const typename Ops::V components[9], typename Ops::V elements[12]) {
+        using V = typename Ops::V;
+
+        V sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+        SinCos<Ops>(components[3], sinPitch, cosPitch);
+        SinCos<Ops>(components[4], sinYaw, cosYaw);
+        SinCos<Ops>(components[5], sinRoll, cosRoll);
+
+        const V sinRollSinPitch = Ops::Mul(sinRoll, sinPitch);
+        const V cosRollSinPitch = Ops::Mul(cosRoll, sinPitch);
+
+        elements[0] = Ops::Mul(components[6], Ops::Add(Ops::Mul(cosRoll, cosYaw), Ops::Mul(sinRollSinPitch, sinYaw)));
+        elements[1] = Ops::Mul(components[6], Ops::Mul(sinRoll, cosPitch));
+        elements[2] = Ops::Mul(components[6], Ops::Sub(Ops::Mul(sinRollSinPitch, cosYaw), Ops::Mul(cosRoll, sinYaw)));
+        elements[3] = Ops::Mul(components[7], Ops::Sub(Ops::Mul(cosRollSinPitch, sinYaw), Ops::Mul(sinRoll, cosYaw)));
+        elements[4] = Ops::Mul(components[7], Ops::Mul(cosRoll, cosPitch));
+        elements[5] = Ops::Mul(components[7], Ops::Add(Ops::Mul(sinRoll, sinYaw), Ops::Mul(cosRollSinPitch, cosYaw)));
+        elements[6] = Ops::Mul(components[8], Ops::Mul(cosPitch, sinYaw));
+        elements[7] = Ops::Mul(components[8], Ops::Sub(Ops::Set1(0.0f), sinPitch));
+        elements[8] = Ops::Mul(components[8], Ops::Mul(cosPitch, cosYaw));
+        elements[9] = components[0];
+        elements[10] = components[1];
+        elements[11] = components[2];
+    }
+
+    // Loads up to WIDTH elements through an index list, unused lanes repeat the first
+    // element and are written to scratch matrices. Every element takes the same vector
+    // path no matter how the work is batched, keeping results independent of batching.
+    template<typename Ops>
+    void ComposeGathered(const LocalTransformArrays& a, const unsigned int* indices, unsigned int count, Matrix* out) {
+        const float* sources[9] = {
+            a.positionX, a.positionY, a.positionZ,
+            a.rotationX, a.rotationY, a.rotationZ,
+            a.scaleX, a.scaleY, a.scaleZ
+        };
+
+        alignas(32) float gathered[9][Ops::WIDTH];
+        Matrix scratch[Ops::WIDTH];
+        Matrix* destinations[Ops::WIDTH];
+        for (unsigned int lane = 0; lane < Ops::WIDTH; lane++) {
+            unsigned int index = indices[lane < count ? lane : 0];
+            for (int c = 0; c < 9; c++) {
+                gathered[c][lane] = sources[c][index];
+            }
+            destinations[lane] = lane < count ? &out[index] : &scratch[lane];
+        }
+
+        typename Ops::V components[9];
+        for (int c = 0; c < 9; c++) {
+            components[c] = Ops::Load(gathered[c]);
+        }
+        typename Ops::V elements[12];
+        ComposeElements<Ops>(components, elements);
+        Ops::Store(elements, destinations);
+    }
+
+    template<typename Ops>
+    void ComposeRange(const LocalTransformArrays& a, unsigned int begin, unsigned int end, Matrix* out) {
+        unsigned int i = begin;
+        for (; i + Ops::WIDTH <= end; i += Ops::WIDTH) {
+            typename Ops::V components[9] = {
+                Ops::Load(a.positionX + i), Ops::Load(a.positionY + i), Ops::Load(a.positionZ + i),
+                Ops::Load(a.rotationX + i), Ops::Load(a.rotationY + i), Ops::Load(a.rotationZ + i),
+                Ops::Load(a.scaleX + i), Ops::Load(a.scaleY + i), Ops::Load(a.scaleZ + i)
+            };
+            typename Ops::V elements[12];
+            ComposeElements<Ops>(components, elements);
+
+            Matrix* destinations[Ops::WIDTH];
+            for (unsigned int lane = 0; lane < Ops::WIDTH; lane++) {
+                destinations[lane] = &out[i + lane];
+            }
+            Ops::Store(elements, destinations);
+        }
+
+        if (i < end) {
+            unsigned int tail[Ops::WIDTH];
+            for (unsigned int lane = 0; lane < end - i; lane++) {
+                tail[lane] = i + lane;
+            }
+            ComposeGathered<Ops>(a, tail, end - i, out);
+        }
+    }
+
+    template<typename Ops>
+    void ComposeIndexed(const LocalTransformArrays& a, const unsigned int* indices, unsigned int count, Matrix* out) {
+        for (unsigned int i = 0; i < count; i += Ops::WIDTH) {
+            unsigned int batch = count - i < Ops::WIDTH ? count - i : Ops::WIDTH;
+            ComposeGathered<Ops>(a, indices + i, batch, out);
+        }
+    }
+#endif
+}
+
+void TransformKernels::ComposeLocalMatricesScalar(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out) {
+    for (unsigned int i = begin; i < end; i++) {
+        ComposeElement(arrays, i, out[i]);
+    }
+}
+
+#ifdef TRANSFORM_KERNELS_SSE
+void TransformKernels::ComposeLocalMatricesSSE(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out) {
+    ComposeRange<SSEOps>(arrays, begin, end, out);
+}
+#endif
+
+#ifdef TRANSFORM_KERNELS_AVX
+void TransformKernels::ComposeLocalMatricesAVX(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out) {
+    ComposeRange<AVXOps>(arrays, begin, end, out);
+}
+#endif
+
+void TransformKernels::ComposeLocalMatrices(const LocalTransformArrays& arrays, unsigned int begin, unsigned int end, Matrix* out) {
+#if defined(TRANSFORM_KERNELS_AVX)
+    ComposeRange<AVXOps>(arrays, begin, end, out);
+#elif defined(TRANSFORM_KERNELS_SSE)
+    ComposeRange<SSEOps>(arrays, begin, end, out);
+#else
+    ComposeLocalMatricesScalar(arrays, begin, end, out);
+#endif
+}
+
+void TransformKernels::ComposeLocalMatrices(const LocalTransformArrays& arrays, const unsigned int* indices, unsigned int count, Matrix* out) {
+#if defined(TRANSFORM_KERNELS_AVX)
+    ComposeIndexed<AVXOps>(arrays, indices, count, out);
+#elif defined(TRANSFORM_KERNELS_SSE)
+    ComposeIndexed<SSEOps>(arrays, indices, count, out);
+#else
+    for (unsigned int i = 0; i < count; i++) {
+        ComposeElement(arrays, indices[i], out[indices[i]]);
+    }
+#endif
+}
+
+const char* TransformKernels::GetInstructionSetName() {
+#if defined(TRANSFORM_KERNELS_AVX)
+    return "AVX";
+#elif defined(TRANSFORM_KERNELS_SSE)
+    return "SSE";
+#else
+    return "Scalar";
+#endif
+}
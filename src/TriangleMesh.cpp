@@ -0,0 +1,153 @@
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    float GetComponent(const Vector3& v, unsigned int axis) {
+        return (&v.x)[axis];
+    }
+
+    AxisAlignedBox EmptyBox() {
+        return AxisAlignedBox(Vector3(FLT_MAX), Vector3(-FLT_MAX));
+    }
+
+    float HalfArea(const AxisAlignedBox& box) {
+        const Vector3 size = box.upper - box.lower;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+}
+
+void TriangleMesh::Build(const std::vector<Vector3>& vertices, const std::vector<unsigned int>& indices) {
+    m_Nodes.clear();
+    m_Triangles.clear();
+    m_Bounds = EmptyBox();
+    const unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<BuildTriangle> triangles(triangleCount);
+    for (unsigned int i = 0; i < triangleCount; i++) {
+        const Vector3& a = vertices[indices[3 * i]];
+        const Vector3& b = vertices[indices[3 * i + 1]];
+        const Vector3& c = vertices[indices[3 * i + 2]];
+        triangles[i].bounds = AxisAlignedBox(Vector3::Min(a, Vector3::Min(b, c)), Vector3::Max(a, Vector3::Max(b, c)));
+        triangles[i].centroid = (a + b + c) / 3.0f;
+        triangles[i].index = i;
+    }
+
+    // Leaves hold a few triangles each, so this is usually enough
+    m_Nodes.reserve(2 * triangleCount / MAX_LEAF_TRIANGLES + 1);
+    m_Triangles.reserve(triangleCount);
+    BuildNode(triangles, 0, triangleCount, 0, vertices, indices);
+    m_Bounds = AxisAlignedBox(m_Nodes[0].lower, m_Nodes[0].upper);
+}
+
+void TriangleMesh::BuildNode(std::vector<BuildTriangle>& triangles, unsigned int begin, unsigned int end, int depth,
+    const std::vector<Vector3>& vertices, const std::vector<unsigned int>& indices) {
+    const uint32_t nodeIndex = static_cast<uint32_t>(m_Nodes.size());
+    m_Nodes.emplace_back();
+
+    AxisAlignedBox bounds = EmptyBox();
+    AxisAlignedBox centroidBounds = EmptyBox();
+    for (unsigned int i = begin; i < end; i++) {
+        bounds = AxisAlignedBox::Union(bounds, triangles[i].bounds);
+        centroidBounds.lower = Vector3::Min(centroidBounds.lower, triangles[i].centroid);
+        centroidBounds.upper = Vector3::Max(centroidBounds.upper, triangles[i].centroid);
+    }
+    m_Nodes[nodeIndex].lower = bounds.lower;
+    m_Nodes[nodeIndex].upper = bounds.upper;
+
+    // Binned SAH: cost of a split is the area of each side times its triangle count
+    const unsigned int count = end - begin;
+    float bestCost = FLT_MAX;
+    unsigned int bestAxis = 0;
+    unsigned int bestSplit = 0;
+    if (count > MAX_LEAF_TRIANGLES && depth < STACK_SIZE - 1) {
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            const float lower = GetComponent(centroidBounds.lower, axis);
+            const float extent = GetComponent(centroidBounds.upper, axis) - lower;
+            if (!(extent > 0.0f)) {
+                continue;
+            }
+
+            AxisAlignedBox binBounds[BIN_COUNT];
+            unsigned int binCounts[BIN_COUNT] = {};
+            std::fill(binBounds, binBounds + BIN_COUNT, EmptyBox());
+            const float scale = BIN_COUNT / extent;
+            for (unsigned int i = begin; i < end; i++) {
+                const unsigned int bin = std::min(BIN_COUNT - 1, static_cast<unsigned int>((GetComponent(triangles[i].centroid, axis) - lower) * scale));
+                binBounds[bin] = AxisAlignedBox::Union(binBounds[bin], triangles[i].bounds);
+                binCounts[bin]++;
+            }
+
+            // Right sides swept from the back, then the left sides from the front
+            float rightAreas[BIN_COUNT];
+            unsigned int rightCounts[BIN_COUNT];
+            AxisAlignedBox side = EmptyBox();
+            unsigned int sideCount = 0;
+            for (unsigned int bin = BIN_COUNT - 1; bin > 0; bin--) {
+                side = AxisAlignedBox::Union(side, binBounds[bin]);
+                sideCount += binCounts[bin];
+                rightAreas[bin] = HalfArea(side);
+                rightCounts[bin] = sideCount;
+            }
+            side = EmptyBox();
+            sideCount = 0;
+            for (unsigned int split = 1; split < BIN_COUNT; split++) {
+                side = AxisAlignedBox::Union(side, binBounds[split - 1]);
+                sideCount += binCounts[split - 1];
+                if (sideCount == 0 || rightCounts[split] == 0) {
+                    continue;
+                }
+                const float cost = HalfArea(side) * sideCount + rightAreas[split] * rightCounts[split];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+    }
+
+    // Splitting stops once it no longer lowers the expected number of triangle tests
+    const float leafCost = HalfArea(bounds) * count;
+    if (bestSplit == 0 || bestCost >= leafCost) {
+        m_Nodes[nodeIndex].offset = static_cast<uint32_t>(m_Triangles.size());
+        m_Nodes[nodeIndex].triangleCount = count;
+        for (unsigned int i = begin; i < end; i++) {
+            const unsigned int index = triangles[i].index;
+            m_Triangles.push_back({ vertices[indices[3 * index]], vertices[indices[3 * index + 1]], vertices[indices[3 * index + 2]] });
+        }
+        return;
+    }
+
+    const float lower = GetComponent(centroidBounds.lower, bestAxis);
+    const float scale = BIN_COUNT / (GetComponent(centroidBounds.upper, bestAxis) - lower);
+    const auto middle = std::partition(triangles.begin() + begin, triangles.begin() + end, [&](const BuildTriangle& triangle) {
+        return std::min(BIN_COUNT - 1, static_cast<unsigned int>((GetComponent(triangle.centroid, bestAxis) - lower) * scale)) < bestSplit;
+    });
+    const unsigned int split = static_cast<unsigned int>(middle - triangles.begin());
+
+    m_Nodes[nodeIndex].triangleCount = 0;
+    BuildNode(triangles, begin, split, depth + 1, vertices, indices);
+    m_Nodes[nodeIndex].offset = static_cast<uint32_t>(m_Nodes.size());
+    BuildNode(triangles, split, end, depth + 1, vertices, indices);
+}
+
+bool TriangleMesh::IsEmpty() const {
+    return m_Triangles.empty();
+}
+
+unsigned int TriangleMesh::GetTriangleCount() const {
+    return static_cast<unsigned int>(m_Triangles.size());
+}
+
+unsigned int TriangleMesh::GetNodeCount() const {
+    return static_cast<unsigned int>(m_Nodes.size());
+}
+
+const AxisAlignedBox& TriangleMesh::GetBounds() const {
+    return m_Bounds;
+}